@@ -0,0 +1,200 @@
+#include "blockCompression.h"
+
+#include <algorithm>
+#include <cstring>
+
+static uint16_t packRGB565(uint32_t r, uint32_t g, uint32_t b) {
+  return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 |
+                               ((g * 63 + 127) / 255) << 5 |
+                               ((b * 31 + 127) / 255));
+}
+
+static RGBA unpackRGB565(uint16_t c) {
+  uint32_t r = (c >> 11) & 31;
+  uint32_t g = (c >> 5) & 63;
+  uint32_t b = c & 31;
+  return RGBA(static_cast<byte>((r << 3) | (r >> 2)),
+              static_cast<byte>((g << 2) | (g >> 4)),
+              static_cast<byte>((b << 3) | (b >> 2)), 255);
+}
+
+static RGBA mixRGB(const RGBA& c0, const RGBA& c1, uint32_t w0, uint32_t w1) {
+  uint32_t sum = w0 + w1;
+  return RGBA(static_cast<byte>((c0.mR * w0 + c1.mR * w1) / sum),
+              static_cast<byte>((c0.mG * w0 + c1.mG * w1) / sum),
+              static_cast<byte>((c0.mB * w0 + c1.mB * w1) / sum), 255);
+}
+
+// Four colors of a color block, the fourth is transparent black in 3-color
+// mode (c0 <= c1, BC1 only)
+static void buildPalette(uint16_t c0, uint16_t c1, bool allowThreeColor,
+                         RGBA* palette) {
+  palette[0] = unpackRGB565(c0);
+  palette[1] = unpackRGB565(c1);
+  if (c0 > c1 || !allowThreeColor) {
+    palette[2] = mixRGB(palette[0], palette[1], 2, 1);
+    palette[3] = mixRGB(palette[0], palette[1], 1, 2);
+  } else {
+    palette[2] = mixRGB(palette[0], palette[1], 1, 1);
+    palette[3] = RGBA(0, 0, 0, 0);
+  }
+}
+
+static uint32_t distanceRGB(const RGBA& a, const RGBA& b) {
+  int32_t r = a.mR - b.mR;
+  int32_t g = a.mG - b.mG;
+  int32_t bl = a.mB - b.mB;
+  return static_cast<uint32_t>(r * r + g * g + bl * bl);
+}
+
+// Endpoints from the inset bounding box of the block's colors, each texel
+// takes the closest palette entry. Texels with alpha < 128 are punched out
+// when punchThrough is set
+static void encodeColorBlock(const RGBA* texels, bool punchThrough,
+                             byte* block) {
+  RGBA lo(255, 255, 255, 255);
+  RGBA hi(0, 0, 0, 255);
+  bool transparent = false;
+  for (int i = 0; i < 16; ++i) {
+    if (punchThrough && texels[i].mA < 128) {
+      transparent = true;
+      continue;
+    }
+    lo.mR = std::min(lo.mR, texels[i].mR);
+    lo.mG = std::min(lo.mG, texels[i].mG);
+    lo.mB = std::min(lo.mB, texels[i].mB);
+    hi.mR = std::max(hi.mR, texels[i].mR);
+    hi.mG = std::max(hi.mG, texels[i].mG);
+    hi.mB = std::max(hi.mB, texels[i].mB);
+  }
+  if (lo.mR > hi.mR) {
+    // Fully transparent block
+    lo = hi;
+  }
+
+  // Pull the endpoints in by 1/16 of the range, the palette then spans the
+  // colors more evenly
+  auto inset = [](byte& l, byte& h) {
+    int32_t d = (h - l) >> 4;
+    l = static_cast<byte>(l + d);
+    h = static_cast<byte>(h - d);
+  };
+  inset(lo.mR, hi.mR);
+  inset(lo.mG, hi.mG);
+  inset(lo.mB, hi.mB);
+
+  uint16_t c0 = packRGB565(hi.mR, hi.mG, hi.mB);
+  uint16_t c1 = packRGB565(lo.mR, lo.mG, lo.mB);
+
+  // 4-color mode needs c0 > c1, 3-color mode c0 <= c1
+  if (transparent ? c0 > c1 : c0 < c1) {
+    std::swap(c0, c1);
+  }
+
+  RGBA palette[4];
+  buildPalette(c0, c1, punchThrough, palette);
+
+  uint32_t indices = 0;
+  bool fourColor = c0 > c1 || !punchThrough;
+  for (int i = 0; i < 16; ++i) {
+    uint32_t best = 0;
+    if (transparent && texels[i].mA < 128) {
+      best = 3;
+    } else {
+      uint32_t bestDistance = distanceRGB(texels[i], palette[0]);
+      for (uint32_t p = 1; p < (fourColor ? 4u : 3u); ++p) {
+        uint32_t distance = distanceRGB(texels[i], palette[p]);
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          best = p;
+        }
+      }
+    }
+    indices |= best << (i * 2);
+  }
+
+  memcpy(block, &c0, sizeof(uint16_t));
+  memcpy(block + 2, &c1, sizeof(uint16_t));
+  memcpy(block + 4, &indices, sizeof(uint32_t));
+}
+
+static void decodeColorBlock(const byte* block, bool allowThreeColor,
+                             RGBA* texels) {
+  uint16_t c0, c1;
+  uint32_t indices;
+  memcpy(&c0, block, sizeof(uint16_t));
+  memcpy(&c1, block + 2, sizeof(uint16_t));
+  memcpy(&indices, block + 4, sizeof(uint32_t));
+
+  RGBA palette[4];
+  buildPalette(c0, c1, allowThreeColor, palette);
+  for (int i = 0; i < 16; ++i) {
+    texels[i] = palette[(indices >> (i * 2)) & 3];
+  }
+}
+
+void BlockCompression::encodeBC1(const RGBA* texels, byte* block) {
+  encodeColorBlock(texels, true, block);
+}
+
+void BlockCompression::decodeBC1(const byte* block, RGBA* texels) {
+  decodeColorBlock(block, true, texels);
+}
+
+void BlockCompression::encodeBC3(const RGBA* texels, byte* block) {
+  byte a0 = 0;
+  byte a1 = 255;
+  for (int i = 0; i < 16; ++i) {
+    a0 = std::max(a0, texels[i].mA);
+    a1 = std::min(a1, texels[i].mA);
+  }
+
+  // 8-alpha mode (a0 > a1): endpoints plus six interpolated steps
+  uint64_t indices = 0;
+  if (a0 > a1) {
+    int32_t range = a0 - a1;
+    for (int i = 0; i < 16; ++i) {
+      // Step 0..7 from a1 to a0, mapped to the palette order
+      int32_t step = ((texels[i].mA - a1) * 7 + range / 2) / range;
+      uint64_t index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+      indices |= index << (i * 3);
+    }
+  }
+
+  block[0] = a0;
+  block[1] = a1;
+  for (int i = 0; i < 6; ++i) {
+    block[2 + i] = static_cast<byte>(indices >> (i * 8));
+  }
+
+  encodeColorBlock(texels, false, block + 8);
+}
+
+void BlockCompression::decodeBC3(const byte* block, RGBA* texels) {
+  decodeColorBlock(block + 8, false, texels);
+
+  uint32_t a0 = block[0];
+  uint32_t a1 = block[1];
+  byte palette[8];
+  palette[0] = static_cast<byte>(a0);
+  palette[1] = static_cast<byte>(a1);
+  if (a0 > a1) {
+    for (uint32_t i = 1; i < 7; ++i) {
+      palette[i + 1] = static_cast<byte>(((7 - i) * a0 + i * a1) / 7);
+    }
+  } else {
+    for (uint32_t i = 1; i < 5; ++i) {
+      palette[i + 1] = static_cast<byte>(((5 - i) * a0 + i * a1) / 5);
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; ++i) {
+    indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+  }
+  for (int i = 0; i < 16; ++i) {
+    texels[i].mA = palette[(indices >> (i * 3)) & 7];
+  }
+}
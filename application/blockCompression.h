@@ -0,0 +1,43 @@
+#pragma once
+#include "../global/base.h"
+
+// Bytes of one compressed 4x4 block
+#define BC1_BLOCK_BYTES 8
+#define BC3_BLOCK_BYTES 16
+
+// S3TC block codecs. BC1 (4 bpp) holds two RGB565 endpoints and 2-bit
+// indices, alpha is either opaque or punched out. BC3 (8 bpp) adds a block of
+// two 8-bit alpha endpoints with 3-bit indices. Texels of a block are in row
+// order, blocks in native byte order
+class BlockCompression {
+ public:
+  static bool isCompressed(int32_t layout) {
+    return layout == IMAGE_LAYOUT_BC1 || layout == IMAGE_LAYOUT_BC3;
+  }
+
+  static uint32_t getBlockBytes(int32_t layout) {
+    return layout == IMAGE_LAYOUT_BC3 ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES;
+  }
+
+  static void encodeBC1(const RGBA* texels, byte* block);
+  static void encodeBC3(const RGBA* texels, byte* block);
+
+  static void decodeBC1(const byte* block, RGBA* texels);
+  static void decodeBC3(const byte* block, RGBA* texels);
+
+  static void encodeBlock(int32_t layout, const RGBA* texels, byte* block) {
+    if (layout == IMAGE_LAYOUT_BC3) {
+      encodeBC3(texels, block);
+    } else {
+      encodeBC1(texels, block);
+    }
+  }
+
+  static void decodeBlock(int32_t layout, const byte* block, RGBA* texels) {
+    if (layout == IMAGE_LAYOUT_BC3) {
+      decodeBC3(block, texels);
+    } else {
+      decodeBC1(block, texels);
+    }
+  }
+};
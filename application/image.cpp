@@ -1,42 +1,129 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "image.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "blockCompression.h"
+#include "srgb.h"
 #include "stb_image.h"
+#include "threadPool.h"
+#include "virtualTexture.h"
+
+// Swap bytes 0 and 2 of every pixel in place, decoders hand out RGBA while
+// RGBA (the struct) is laid out BGRA
+static void swizzleRGBAToBGRA(byte* data, size_t pixelCount) {
+  size_t i = 0;
+
+#ifdef SIMD_AVX2
+  const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4,
+      7, 10, 9, 8, 11, 14, 13, 12, 15);
+  for (; i + 8 <= pixelCount; i += 8) {
+    auto p = reinterpret_cast<__m256i*>(data + i * 4);
+    _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), shuffle));
+  }
+#endif
+
+#if defined(SIMD_SSSE3)
+  const __m128i shuffle4 =
+      _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  for (; i + 4 <= pixelCount; i += 4) {
+    auto p = reinterpret_cast<__m128i*>(data + i * 4);
+    _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), shuffle4));
+  }
+#elif defined(SIMD_SSE2)
+  // SSE2 has no byte shuffle: keep G/A, move R and B with 32-bit shifts
+  const __m128i keep = _mm_set1_epi32(0xFF00FF00);
+  const __m128i low = _mm_set1_epi32(0x000000FF);
+  for (; i + 4 <= pixelCount; i += 4) {
+    auto p = reinterpret_cast<__m128i*>(data + i * 4);
+    __m128i v = _mm_loadu_si128(p);
+    __m128i r = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+    __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(v, keep),
+                                     _mm_or_si128(r, b)));
+  }
+#endif
+
+  for (; i < pixelCount; ++i) {
+    uint32_t v;
+    memcpy(&v, data + i * 4, sizeof(uint32_t));
+    v = (v & 0xFF00FF00) | ((v & 0xFF) << 16) | ((v >> 16) & 0xFF);
+    memcpy(data + i * 4, &v, sizeof(uint32_t));
+  }
+}
+
+std::atomic<uint32_t> Image::sDataEpoch{0};
 
 Image::Image(const uint32_t& width, const uint32_t& height, RGBA* data) {
   mWidth = width;
   mHeight = height;
+  mLayerSize = width * height;
   if (data) {
     mData = new RGBA[mWidth * mHeight];
     memcpy(mData, data, sizeof(RGBA) * mWidth * mHeight);
   }
 }
 
+Image::Image(const uint32_t& width, const uint32_t& height, RGBA* data,
+             Deleter deleter) {
+  mWidth = width;
+  mHeight = height;
+  mLayerSize = width * height;
+  mData = data;
+  mDeleter = std::move(deleter);
+}
+
 Image::~Image() {
-  if (mData != nullptr) {
-    delete[] mData;
+  releaseData();
+
+  for (auto mipmap : mMipmaps) {
+    delete mipmap;
   }
 }
 
+// Takes a stb_image RGBA buffer
+static Image* adoptDecoded(byte* bits, int width, int height) {
+  if (!bits) {
+    return nullptr;
+  }
+
+  swizzleRGBAToBGRA(bits, static_cast<size_t>(width) * height);
+
+  // Adopt the decoder's buffer instead of copying it
+  Image* image = new Image(width, height, reinterpret_cast<RGBA*>(bits),
+                           [](RGBA* data) { stbi_image_free(data); });
+
+  image->generateMipmaps();
+
+  return image;
+}
+
 Image* Image::createImage(const std::string& path) {
   int picType = 0;
   int width{0}, height{0};
 
-  stbi_set_flip_vertically_on_load(true);
+  // Per-thread flag, createImage also runs on loader threads
+  stbi_set_flip_vertically_on_load_thread(true);
 
   unsigned char* bits =
       stbi_load(path.c_str(), &width, &height, &picType, STBI_rgb_alpha);
-  for (int i = 0; i < width * height * 4; i += 4) {
-    byte tmp = bits[i];
-    bits[i] = bits[i + 2];
-    bits[i + 2] = tmp;
-  }
 
-  Image* image = new Image(width, height, (RGBA*)bits);
+  return adoptDecoded(bits, width, height);
+}
+
+Image* Image::createImageFromMemory(const byte* data, size_t size) {
+  int picType = 0;
+  int width{0}, height{0};
 
-  stbi_image_free(bits);
+  stbi_set_flip_vertically_on_load_thread(true);
 
-  return image;
+  unsigned char* bits =
+      stbi_load_from_memory(data, static_cast<int>(size), &width, &height,
+                            &picType, STBI_rgb_alpha);
+
+  return adoptDecoded(bits, width, height);
 }
 
 void Image::destroyImage(Image* image) {
@@ -44,3 +131,321 @@ void Image::destroyImage(Image* image) {
     delete image;
   }
 }
+
+std::future<Image*> Image::createImageAsync(const std::string& path) {
+  return ThreadPool::getShared()->submit(
+      [path]() { return createImage(path); });
+}
+
+std::vector<Image*> Image::createImages(
+    const std::vector<std::string>& paths) {
+  std::vector<std::future<Image*>> futures;
+  futures.reserve(paths.size());
+  for (auto& path : paths) {
+    futures.push_back(createImageAsync(path));
+  }
+
+  std::vector<Image*> images;
+  images.reserve(paths.size());
+  for (auto& future : futures) {
+    images.push_back(future.get());
+  }
+
+  return images;
+}
+
+Image* Image::createImageArray(const std::vector<const Image*>& images) {
+  if (images.empty()) {
+    return nullptr;
+  }
+
+  uint32_t width = images[0]->mWidth;
+  uint32_t height = images[0]->mHeight;
+
+  uint32_t layers = 0;
+  for (auto image : images) {
+    if (image->mWidth != width || image->mHeight != height) {
+      return nullptr;
+    }
+    layers += image->mLayers;
+  }
+
+  Image* array = new Image(width, height);
+  array->mLayers = layers;
+  array->mData = new RGBA[array->mLayerSize * layers];
+
+  RGBA* dst = array->mData;
+  for (auto image : images) {
+    for (uint32_t l = 0; l < image->mLayers; ++l) {
+      for (uint32_t j = 0; j < height; ++j) {
+        for (uint32_t i = 0; i < width; ++i) {
+          *dst++ = image->getTexel(i, j, l);
+        }
+      }
+    }
+  }
+
+  array->generateMipmaps();
+
+  return array;
+}
+
+void Image::generateMipmaps() {
+  // The mip chain of a virtual image was paged along with level 0
+  if (mLayout == IMAGE_LAYOUT_VIRTUAL) {
+    return;
+  }
+
+  for (auto mipmap : mMipmaps) {
+    delete mipmap;
+  }
+  mMipmaps.clear();
+
+  // The box filter below walks rows linearly. Compressed data is not
+  // decoded in place: encoding level 0 again would lose quality on every
+  // call, so the chain is filtered from a decoded copy instead
+  int32_t layout = mLayout;
+  std::unique_ptr<Image> decoded;
+  if (BlockCompression::isCompressed(layout)) {
+    decoded = std::make_unique<Image>(mWidth, mHeight, mData, [](RGBA*) {});
+    decoded->mLayout = layout;
+    decoded->mLayers = mLayers;
+    decoded->mLayerSize = mLayerSize;
+    decoded->mTilesPerRow = mTilesPerRow;
+    decoded->setLayout(IMAGE_LAYOUT_LINEAR);
+  } else {
+    setLayout(IMAGE_LAYOUT_LINEAR);
+  }
+
+  const Image* src = decoded ? decoded.get() : this;
+  while (src->mWidth > 1 || src->mHeight > 1) {
+    uint32_t width = std::max(src->mWidth / 2, 1u);
+    uint32_t height = std::max(src->mHeight / 2, 1u);
+
+    Image* dst = new Image(width, height);
+    dst->mLayers = mLayers;
+    dst->mSRGB = mSRGB;
+    dst->mData = new RGBA[dst->mLayerSize * mLayers];
+
+    // Odd sized levels clamp the second tap to the last row/column
+    for (uint32_t l = 0; l < mLayers; ++l) {
+      const RGBA* srcData = src->getLayerData(l);
+      RGBA* dstData = dst->mData + l * dst->mLayerSize;
+
+      for (uint32_t j = 0; j < height; ++j) {
+        uint32_t y0 = std::min(j * 2, src->mHeight - 1);
+        uint32_t y1 = std::min(j * 2 + 1, src->mHeight - 1);
+        const RGBA* row0 = srcData + y0 * src->mWidth;
+        const RGBA* row1 = srcData + y1 * src->mWidth;
+
+        for (uint32_t i = 0; i < width; ++i) {
+          uint32_t x0 = std::min(i * 2, src->mWidth - 1);
+          uint32_t x1 = std::min(i * 2 + 1, src->mWidth - 1);
+
+          const RGBA& c0 = row0[x0];
+          const RGBA& c1 = row0[x1];
+          const RGBA& c2 = row1[x0];
+          const RGBA& c3 = row1[x1];
+
+          RGBA& result = dstData[j * width + i];
+          if (mSRGB) {
+            result = SRGB::average(c0, c1, c2, c3);
+            continue;
+          }
+          result.mR = (c0.mR + c1.mR + c2.mR + c3.mR + 2) >> 2;
+          result.mG = (c0.mG + c1.mG + c2.mG + c3.mG + 2) >> 2;
+          result.mB = (c0.mB + c1.mB + c2.mB + c3.mB + 2) >> 2;
+          result.mA = (c0.mA + c1.mA + c2.mA + c3.mA + 2) >> 2;
+        }
+      }
+    }
+
+    mMipmaps.push_back(dst);
+    src = dst;
+  }
+
+  setLayout(layout);
+}
+
+void Image::setSRGB(bool srgb) {
+  if (srgb == mSRGB) {
+    return;
+  }
+
+  mSRGB = srgb;
+  if (mMipmaps.empty()) {
+    return;
+  }
+
+  generateMipmaps();
+  for (auto mipmap : mMipmaps) {
+    mipmap->mSRGB = srgb;
+  }
+}
+
+const Image* Image::getMipmap(uint32_t level) const {
+  if (level == 0 || mMipmaps.empty()) {
+    return this;
+  }
+
+  level = std::min(level, static_cast<uint32_t>(mMipmaps.size()));
+  return mMipmaps[level - 1];
+}
+
+RGBA Image::getTexel(uint32_t x, uint32_t y, uint32_t layer) const {
+  if (mLayout == IMAGE_LAYOUT_VIRTUAL) {
+    return mVirtual->getTexel(mVirtualLevel, x, y);
+  }
+
+  const RGBA* data = getLayerData(layer);
+  if (BlockCompression::isCompressed(mLayout)) {
+    RGBA texels[IMAGE_TILE_SIZE * IMAGE_TILE_SIZE];
+    const byte* block = mLayout == IMAGE_LAYOUT_BC3
+                            ? getBlock<BC3_BLOCK_BYTES>(data, x, y)
+                            : getBlock<BC1_BLOCK_BYTES>(data, x, y);
+    BlockCompression::decodeBlock(mLayout, block, texels);
+    return texels[((y & IMAGE_TILE_MASK) << IMAGE_TILE_SHIFT) +
+                  (x & IMAGE_TILE_MASK)];
+  }
+  if (mLayout == IMAGE_LAYOUT_TILED) {
+    return data[getTexelIndex<IMAGE_LAYOUT_TILED>(x, y)];
+  }
+  return data[getTexelIndex<IMAGE_LAYOUT_LINEAR>(x, y)];
+}
+
+void Image::setLayout(int32_t layout) {
+  if (mLayout == IMAGE_LAYOUT_VIRTUAL || layout == IMAGE_LAYOUT_VIRTUAL) {
+    return;
+  }
+
+  for (auto mipmap : mMipmaps) {
+    mipmap->convertLayout(layout);
+  }
+  convertLayout(layout);
+}
+
+void Image::convertLayout(int32_t layout) {
+  if (layout == mLayout || !mData) {
+    mLayout = layout;
+    return;
+  }
+
+  // Tiled and compressed layouts convert through the linear one
+  if (mLayout != IMAGE_LAYOUT_LINEAR && layout != IMAGE_LAYOUT_LINEAR) {
+    convertLayout(IMAGE_LAYOUT_LINEAR);
+  }
+
+  uint32_t tilesPerRow = (mWidth + IMAGE_TILE_MASK) >> IMAGE_TILE_SHIFT;
+  uint32_t tileRows = (mHeight + IMAGE_TILE_MASK) >> IMAGE_TILE_SHIFT;
+
+  RGBA* data = nullptr;
+  uint32_t layerSize = 0;
+  if (layout == IMAGE_LAYOUT_TILED) {
+    // Edge tiles are padded by replicating the last row/column
+    layerSize = tilesPerRow * tileRows * IMAGE_TILE_SIZE * IMAGE_TILE_SIZE;
+    data = (new TexelTile[tilesPerRow * tileRows * mLayers])->mTexels;
+    mTilesPerRow = tilesPerRow;
+    for (uint32_t l = 0; l < mLayers; ++l) {
+      const RGBA* src = getLayerData(l);
+      RGBA* dst = data + l * layerSize;
+      for (uint32_t j = 0; j < tileRows * IMAGE_TILE_SIZE; ++j) {
+        uint32_t y = std::min(j, mHeight - 1);
+        for (uint32_t i = 0; i < tilesPerRow * IMAGE_TILE_SIZE; ++i) {
+          uint32_t x = std::min(i, mWidth - 1);
+          dst[getTexelIndex<IMAGE_LAYOUT_TILED>(i, j)] =
+              src[getTexelIndex<IMAGE_LAYOUT_LINEAR>(x, y)];
+        }
+      }
+    }
+  } else if (BlockCompression::isCompressed(layout)) {
+    // Edge blocks are padded the same way as edge tiles
+    uint32_t blockBytes = BlockCompression::getBlockBytes(layout);
+    layerSize = tilesPerRow * tileRows * blockBytes / sizeof(RGBA);
+    data = new RGBA[layerSize * mLayers];
+    for (uint32_t l = 0; l < mLayers; ++l) {
+      const RGBA* src = getLayerData(l);
+      auto dst = reinterpret_cast<byte*>(data + l * layerSize);
+      for (uint32_t by = 0; by < tileRows; ++by) {
+        for (uint32_t bx = 0; bx < tilesPerRow; ++bx) {
+          RGBA texels[IMAGE_TILE_SIZE * IMAGE_TILE_SIZE];
+          for (uint32_t j = 0; j < IMAGE_TILE_SIZE; ++j) {
+            uint32_t y = std::min((by << IMAGE_TILE_SHIFT) + j, mHeight - 1);
+            for (uint32_t i = 0; i < IMAGE_TILE_SIZE; ++i) {
+              uint32_t x = std::min((bx << IMAGE_TILE_SHIFT) + i, mWidth - 1);
+              texels[(j << IMAGE_TILE_SHIFT) + i] =
+                  src[getTexelIndex<IMAGE_LAYOUT_LINEAR>(x, y)];
+            }
+          }
+          BlockCompression::encodeBlock(
+              layout, texels, dst + (by * tilesPerRow + bx) * blockBytes);
+        }
+      }
+    }
+  } else if (BlockCompression::isCompressed(mLayout)) {
+    uint32_t blockBytes = BlockCompression::getBlockBytes(mLayout);
+    layerSize = mWidth * mHeight;
+    data = new RGBA[layerSize * mLayers];
+    for (uint32_t l = 0; l < mLayers; ++l) {
+      auto src = reinterpret_cast<const byte*>(getLayerData(l));
+      RGBA* dst = data + l * layerSize;
+      for (uint32_t by = 0; by < tileRows; ++by) {
+        for (uint32_t bx = 0; bx < tilesPerRow; ++bx) {
+          RGBA texels[IMAGE_TILE_SIZE * IMAGE_TILE_SIZE];
+          BlockCompression::decodeBlock(
+              mLayout, src + (by * tilesPerRow + bx) * blockBytes, texels);
+
+          uint32_t height = std::min(mHeight - (by << IMAGE_TILE_SHIFT),
+                                     static_cast<uint32_t>(IMAGE_TILE_SIZE));
+          uint32_t width = std::min(mWidth - (bx << IMAGE_TILE_SHIFT),
+                                    static_cast<uint32_t>(IMAGE_TILE_SIZE));
+          for (uint32_t j = 0; j < height; ++j) {
+            for (uint32_t i = 0; i < width; ++i) {
+              dst[getTexelIndex<IMAGE_LAYOUT_LINEAR>(
+                  (bx << IMAGE_TILE_SHIFT) + i, (by << IMAGE_TILE_SHIFT) + j)] =
+                  texels[(j << IMAGE_TILE_SHIFT) + i];
+            }
+          }
+        }
+      }
+    }
+  } else {
+    layerSize = mWidth * mHeight;
+    data = new RGBA[layerSize * mLayers];
+    for (uint32_t l = 0; l < mLayers; ++l) {
+      const RGBA* src = getLayerData(l);
+      RGBA* dst = data + l * layerSize;
+      for (uint32_t j = 0; j < mHeight; ++j) {
+        for (uint32_t i = 0; i < mWidth; ++i) {
+          dst[getTexelIndex<IMAGE_LAYOUT_LINEAR>(i, j)] =
+              src[getTexelIndex<IMAGE_LAYOUT_TILED>(i, j)];
+        }
+      }
+    }
+  }
+
+  releaseData();
+  mData = data;
+  mLayout = layout;
+  mLayerSize = layerSize;
+  mTilesPerRow = layout == IMAGE_LAYOUT_LINEAR ? 0 : tilesPerRow;
+}
+
+void Image::releaseData() {
+  // The address may be reused by other texels, and virtual levels are keyed
+  // by the image itself
+  sDataEpoch.fetch_add(1, std::memory_order_relaxed);
+
+  if (mData == nullptr) {
+    return;
+  }
+
+  if (mDeleter) {
+    mDeleter(mData);
+    mDeleter = nullptr;
+  } else if (mLayout == IMAGE_LAYOUT_TILED) {
+    delete[] reinterpret_cast<TexelTile*>(mData);
+  } else {
+    delete[] mData;
+  }
+  mData = nullptr;
+}
@@ -1,17 +1,141 @@
 #pragma once
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+
 #include "../global/base.h"
 
+// Texels per tile edge of IMAGE_LAYOUT_TILED, a 4x4 RGBA tile is 64 bytes
+#define IMAGE_TILE_SIZE 4
+#define IMAGE_TILE_SHIFT 2
+#define IMAGE_TILE_MASK 3
+
+// One tile of IMAGE_LAYOUT_TILED, aligned so that it fills one cache line
+struct alignas(64) TexelTile {
+  RGBA mTexels[IMAGE_TILE_SIZE * IMAGE_TILE_SIZE];
+};
+
+class VirtualTexture;
+
 class Image {
  public:
+  // Releases adopted pixel memory, e.g. a decoder's buffer
+  using Deleter = std::function<void(RGBA* data)>;
+
+  // Copies data
   Image(const uint32_t& width = 0, const uint32_t& height = 0,
         RGBA* data = nullptr);
+
+  // Takes ownership of data without copying, deleter frees it
+  Image(const uint32_t& width, const uint32_t& height, RGBA* data,
+        Deleter deleter);
   ~Image();
 
   static Image* createImage(const std::string& path);
   static void destroyImage(Image* image);
 
+  // Decode an encoded (png/jpg/...) file already in memory
+  static Image* createImageFromMemory(const byte* data, size_t size);
+
+  // Decode on the shared loader thread pool, the future yields the image
+  // (nullptr if decoding failed)
+  static std::future<Image*> createImageAsync(const std::string& path);
+
+  // Decode all paths in parallel and wait for them, results keep path order
+  static std::vector<Image*> createImages(
+      const std::vector<std::string>& paths);
+
+  // Pack equally sized images into the layers of one texture array, so
+  // triangles using different images can share a single binding. nullptr if
+  // the sizes differ
+  static Image* createImageArray(const std::vector<const Image*>& images);
+
+  // Build the mip chain down to 1x1 with a 2x2 box filter
+  void generateMipmaps();
+
+  // Flag texels as sRGB encoded, so that filtering happens in linear light.
+  // Applies to all levels, an existing mip chain is rebuilt
+  void setSRGB(bool srgb);
+
+  // Level 0 is the image itself
+  uint32_t getMipLevels() const {
+    return static_cast<uint32_t>(mMipmaps.size()) + 1;
+  }
+  const Image* getMipmap(uint32_t level) const;
+
+  // Reorder texels of every mip level into the given IMAGE_LAYOUT_*.
+  // IMAGE_LAYOUT_TILED stores 4x4 blocks contiguously so that 2D neighbours
+  // share a cache line regardless of sampling direction. IMAGE_LAYOUT_BC1/BC3
+  // compress 4x4 blocks to 8/16 bytes (lossy), mData then holds the blocks
+  // and mLayerSize counts RGBA sized units of them. Virtual images keep their
+  // paged layout
+  void setLayout(int32_t layout);
+
+  template <int32_t LAYOUT>
+  uint32_t getTexelIndex(uint32_t x, uint32_t y) const {
+    if constexpr (LAYOUT == IMAGE_LAYOUT_TILED) {
+      uint32_t tile = (y >> IMAGE_TILE_SHIFT) * mTilesPerRow +
+                      (x >> IMAGE_TILE_SHIFT);
+      return (tile << (IMAGE_TILE_SHIFT * 2)) +
+             ((y & IMAGE_TILE_MASK) << IMAGE_TILE_SHIFT) +
+             (x & IMAGE_TILE_MASK);
+    } else {
+      return y * mWidth + x;
+    }
+  }
+
+  const RGBA* getLayerData(uint32_t layer) const {
+    return mData + layer * mLayerSize;
+  }
+
+  // Compressed block holding texel (x, y) of IMAGE_LAYOUT_BC1/BC3 data
+  template <uint32_t BLOCK_BYTES>
+  const byte* getBlock(const RGBA* data, uint32_t x, uint32_t y) const {
+    uint32_t block = (y >> IMAGE_TILE_SHIFT) * mTilesPerRow +
+                     (x >> IMAGE_TILE_SHIFT);
+    return reinterpret_cast<const byte*>(data) + block * BLOCK_BYTES;
+  }
+
+  // Bumped whenever texel memory of any image is released, caches keyed by
+  // data address must be dropped when it changes
+  static uint32_t getDataEpoch() {
+    return sDataEpoch.load(std::memory_order_relaxed);
+  }
+
+  // Layout independent texel read, for code outside the sampler
+  RGBA getTexel(uint32_t x, uint32_t y, uint32_t layer = 0) const;
+
+ private:
+  // setLayout for this level alone
+  void convertLayout(int32_t layout);
+
+  void releaseData();
+
+  static std::atomic<uint32_t> sDataEpoch;
+
  public:
   uint32_t mWidth{0};
   uint32_t mHeight{0};
   RGBA* mData{nullptr};
-};
\ No newline at end of file
+  Deleter mDeleter;
+
+  int32_t mLayout{IMAGE_LAYOUT_LINEAR};
+
+  // 4x4 tiles or compressed blocks per row
+  uint32_t mTilesPerRow{0};
+
+  bool mSRGB{false};
+
+  // Layers are stored back to back, mLayerSize texels apart
+  uint32_t mLayers{1};
+  uint32_t mLayerSize{0};
+
+  // Mip levels 1..n, each one half the size of the previous
+  std::vector<Image*> mMipmaps;
+
+  // IMAGE_LAYOUT_VIRTUAL: no mData, texels of level mVirtualLevel are paged
+  // in by mVirtual, which all levels share
+  std::shared_ptr<const VirtualTexture> mVirtual;
+  uint32_t mVirtualLevel{0};
+};
@@ -0,0 +1,127 @@
+#include "mappedFile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile() { close(); }
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path) {
+  close();
+
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  mFile = file;
+  mMapping = mapping;
+  mData = static_cast<const byte*>(data);
+  mSize = static_cast<size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::close() {
+  if (mData) {
+    UnmapViewOfFile(mData);
+  }
+  if (mMapping) {
+    CloseHandle(mMapping);
+  }
+  if (mFile) {
+    CloseHandle(mFile);
+  }
+
+  mData = nullptr;
+  mSize = 0;
+  mMapping = nullptr;
+  mFile = nullptr;
+}
+
+void MappedFile::discard(size_t offset, size_t size) const {
+  // Clean file backed views are already trimmed from the working set under
+  // memory pressure, there is no per-range hint for read-only views
+}
+#else
+bool MappedFile::open(const std::string& path) {
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  mData = static_cast<const byte*>(data);
+  mSize = static_cast<size_t>(info.st_size);
+  return true;
+}
+
+void MappedFile::close() {
+  if (mData) {
+    munmap(const_cast<byte*>(mData), mSize);
+  }
+
+  mData = nullptr;
+  mSize = 0;
+}
+
+void MappedFile::discard(size_t offset, size_t size) const {
+  if (!mData || offset >= mSize) {
+    return;
+  }
+
+  // madvise wants a page aligned start. glibc ignores POSIX_MADV_DONTNEED,
+  // MADV_DONTNEED does drop the pages of a private read-only mapping
+  size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size = std::min(size, mSize - offset);
+  size += offset % pageSize;
+  offset -= offset % pageSize;
+  madvise(const_cast<byte*>(mData + offset), size, MADV_DONTNEED);
+}
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+#include "../global/base.h"
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+
+  bool open(const std::string& path);
+  void close();
+
+  bool isOpen() const { return mData != nullptr; }
+  const byte* getData() const { return mData; }
+  size_t getSize() const { return mSize; }
+
+  // Let the OS drop the given range from memory, it is read back from the
+  // file on the next access. The start is rounded down to a page boundary
+  void discard(size_t offset, size_t size) const;
+
+ private:
+  const byte* mData{nullptr};
+  size_t mSize{0};
+
+#ifdef _WIN32
+  void* mFile{nullptr};
+  void* mMapping{nullptr};
+#endif
+};
@@ -0,0 +1,71 @@
+#include "srgb.h"
+
+#include <cmath>
+
+// The only place pow is evaluated
+SRGB::Tables::Tables() {
+  for (uint32_t i = 0; i < 256; ++i) {
+    float c = static_cast<float>(i) / 255.0f;
+    mDecode[i] = c <= 0.04045f ? c / 12.92f
+                               : std::pow((c + 0.055f) / 1.055f, 2.4f);
+  }
+
+  for (uint32_t i = 0; i < SRGB_ENCODE_TABLE_SIZE; ++i) {
+    float l = static_cast<float>(i) / (SRGB_ENCODE_TABLE_SIZE - 1);
+    float c = l <= 0.0031308f ? l * 12.92f
+                              : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+    mEncode[i] = static_cast<byte>(c * 255.0f + 0.5f);
+  }
+}
+
+static byte lerpAlpha(byte a0, byte a1, float w0, float w1) {
+  return static_cast<byte>(static_cast<float>(a0) * w0 +
+                           static_cast<float>(a1) * w1 + 0.5f);
+}
+
+RGBA SRGB::lerp(const RGBA& c0, const RGBA& c1, float weight) {
+  float w0 = 1.0f - weight;
+  RGBA result;
+  result.mR = encode(decode(c0.mR) * w0 + decode(c1.mR) * weight);
+  result.mG = encode(decode(c0.mG) * w0 + decode(c1.mG) * weight);
+  result.mB = encode(decode(c0.mB) * w0 + decode(c1.mB) * weight);
+  result.mA = lerpAlpha(c0.mA, c1.mA, w0, weight);
+  return result;
+}
+
+RGBA SRGB::bilinear(const RGBA& leftBottom, const RGBA& rightBottom,
+                    const RGBA& leftTop, const RGBA& rightTop, uint32_t fx,
+                    uint32_t fy) {
+  float x = static_cast<float>(fx) / 256.0f;
+  float y = static_cast<float>(fy) / 256.0f;
+  float w[4] = {(1.0f - x) * (1.0f - y), x * (1.0f - y), (1.0f - x) * y,
+                x * y};
+  const RGBA* c[4] = {&leftBottom, &rightBottom, &leftTop, &rightTop};
+
+  float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+  for (int i = 0; i < 4; ++i) {
+    r += decode(c[i]->mR) * w[i];
+    g += decode(c[i]->mG) * w[i];
+    b += decode(c[i]->mB) * w[i];
+    a += static_cast<float>(c[i]->mA) * w[i];
+  }
+
+  return RGBA(encode(r), encode(g), encode(b), static_cast<byte>(a + 0.5f));
+}
+
+RGBA SRGB::blend(const RGBA& src, const RGBA& dst) {
+  float weight = static_cast<float>(src.mA) / 255.0f;
+  return lerp(dst, src, weight);
+}
+
+RGBA SRGB::average(const RGBA& c0, const RGBA& c1, const RGBA& c2,
+                   const RGBA& c3) {
+  auto channel = [](byte v0, byte v1, byte v2, byte v3) {
+    return encode((decode(v0) + decode(v1) + decode(v2) + decode(v3)) * 0.25f);
+  };
+
+  return RGBA(channel(c0.mR, c1.mR, c2.mR, c3.mR),
+              channel(c0.mG, c1.mG, c2.mG, c3.mG),
+              channel(c0.mB, c1.mB, c2.mB, c3.mB),
+              static_cast<byte>((c0.mA + c1.mA + c2.mA + c3.mA + 2) >> 2));
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+
+#include "../global/base.h"
+
+// Entries of the linear -> sRGB table, linear values are quantized to 12 bits
+#define SRGB_ENCODE_TABLE_SIZE 4096
+
+// sRGB transfer function by table lookup. Colors stay sRGB encoded in 8 bits
+// wherever they are stored, math on them (filtering, blending) decodes to
+// linear light first and encodes the result again. Alpha is always linear
+class SRGB {
+ public:
+  // 0..255 sRGB -> 0..1 linear
+  static float decode(byte value) { return getTables().mDecode[value]; }
+
+  // 0..1 linear -> 0..255 sRGB, clamped
+  static byte encode(float linear) {
+    float index = linear * (SRGB_ENCODE_TABLE_SIZE - 1) + 0.5f;
+    index = std::min(std::max(index, 0.0f),
+                     static_cast<float>(SRGB_ENCODE_TABLE_SIZE - 1));
+    return getTables().mEncode[static_cast<uint32_t>(index)];
+  }
+
+  // Table behind encode, index is linear * (SRGB_ENCODE_TABLE_SIZE - 1)
+  static const byte* getEncodeTable() { return getTables().mEncode; }
+
+  // Raster::lerpRGBA in linear light
+  static RGBA lerp(const RGBA& c0, const RGBA& c1, float weight);
+
+  // Raster::bilinearRGBA in linear light, fx/fy are 8-bit fractions
+  static RGBA bilinear(const RGBA& leftBottom, const RGBA& rightBottom,
+                       const RGBA& leftTop, const RGBA& rightTop, uint32_t fx,
+                       uint32_t fy);
+
+  // Source over destination by source alpha, in linear light
+  static RGBA blend(const RGBA& src, const RGBA& dst);
+
+  // Rounded average of a 2x2 block, for mip generation
+  static RGBA average(const RGBA& c0, const RGBA& c1, const RGBA& c2,
+                      const RGBA& c3);
+
+ private:
+  struct Tables {
+    Tables();
+
+    float mDecode[256];
+    byte mEncode[SRGB_ENCODE_TABLE_SIZE];
+  };
+
+  // Built on first use, so that static initializers of other files (images,
+  // pool tasks) never see the tables unfilled
+  static const Tables& getTables() {
+    static const Tables sTables;
+    return sTables;
+  }
+};
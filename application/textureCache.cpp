@@ -0,0 +1,261 @@
+#include "textureCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <memory>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+#include "blockCompression.h"
+#include "mappedFile.h"
+#include "virtualTexture.h"
+
+static uint64_t alignOffset(uint64_t offset) {
+  return (offset + TEXTURE_CACHE_ALIGNMENT - 1) &
+         ~static_cast<uint64_t>(TEXTURE_CACHE_ALIGNMENT - 1);
+}
+
+TextureCache::TextureCache(const std::string& directory, int32_t layout) {
+  mDirectory = directory;
+  mLayout = layout;
+
+  std::error_code error;
+  std::filesystem::create_directories(mDirectory, error);
+}
+
+TextureCache::~TextureCache() {}
+
+std::string TextureCache::getCachePath(uint64_t sourceHash) const {
+  // The same source may be cached once per layout
+  char name[48];
+  snprintf(name, sizeof(name), "%016llx_%d.stex",
+           static_cast<unsigned long long>(sourceHash), mLayout);
+
+  return (std::filesystem::path(mDirectory) / name).string();
+}
+
+Image* TextureCache::loadImage(const std::string& sourcePath) {
+  MappedFile source;
+  if (!source.open(sourcePath)) {
+    return nullptr;
+  }
+
+  uint64_t hash = hashData(source.getData(), source.getSize());
+  std::string cachePath = getCachePath(hash);
+
+  bool paged = mLayout == IMAGE_LAYOUT_VIRTUAL;
+  Image* image = paged ? VirtualTexture::createImage(cachePath, mVirtualBudget)
+                       : mapImage(cachePath, hash);
+  if (image) {
+    return image;
+  }
+
+  image = Image::createImageFromMemory(source.getData(), source.getSize());
+  if (!image) {
+    return nullptr;
+  }
+
+  if (paged) {
+    // Page the decoded copy out and drop it, only the budget stays resident
+    std::string tempPath = cachePath + ".tmp";
+    bool written = VirtualTexture::writePaged(image, tempPath, hash);
+    Image::destroyImage(image);
+    if (!written) {
+      return nullptr;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    return VirtualTexture::createImage(error ? tempPath : cachePath,
+                                       mVirtualBudget);
+  }
+  image->setLayout(mLayout);
+
+  // Written under a temporary name so readers never see a partial file
+  std::string tempPath = cachePath + ".tmp";
+  if (writeImage(image, tempPath, hash)) {
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+  }
+
+  return image;
+}
+
+bool TextureCache::writeImage(const Image* image, const std::string& path,
+                              uint64_t sourceHash) {
+  if (!image || !image->mData) {
+    return false;
+  }
+
+  TextureCacheHeader header;
+  header.mWidth = image->mWidth;
+  header.mHeight = image->mHeight;
+  header.mLevels = image->getMipLevels();
+  header.mLayers = image->mLayers;
+  header.mLayout = image->mLayout;
+  header.mSourceHash = sourceHash;
+
+  std::vector<TextureCacheLevel> levels(header.mLevels);
+  uint64_t offset = alignOffset(sizeof(TextureCacheHeader) +
+                                sizeof(TextureCacheLevel) * header.mLevels);
+  for (uint32_t i = 0; i < header.mLevels; ++i) {
+    const Image* level = image->getMipmap(i);
+    levels[i].mOffset = offset;
+    levels[i].mWidth = level->mWidth;
+    levels[i].mHeight = level->mHeight;
+    levels[i].mLayerSize = level->mLayerSize;
+    levels[i].mTilesPerRow = level->mTilesPerRow;
+
+    offset = alignOffset(offset + static_cast<uint64_t>(level->mLayerSize) *
+                                      level->mLayers * sizeof(RGBA));
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  if (ok && header.mLevels) {
+    ok = fwrite(levels.data(), sizeof(TextureCacheLevel), levels.size(),
+                file) == levels.size();
+  }
+
+  for (uint32_t i = 0; ok && i < header.mLevels; ++i) {
+    const Image* level = image->getMipmap(i);
+    ok = seekFile(file, levels[i].mOffset);
+
+    size_t count = static_cast<size_t>(level->mLayerSize) * level->mLayers;
+    ok = ok && fwrite(level->mData, sizeof(RGBA), count, file) == count;
+  }
+
+  ok = (fclose(file) == 0) && ok;
+  if (!ok) {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+
+  return ok;
+}
+
+// Texels (RGBA sized units for compressed layouts) per layer of a level
+// with the given geometry, 0 if the geometry is invalid for the layout
+static uint64_t getLayerSize(int32_t layout, uint32_t width, uint32_t height,
+                             uint32_t tilesPerRow) {
+  if (width == 0 || height == 0) {
+    return 0;
+  }
+
+  uint64_t tiles = (width + IMAGE_TILE_MASK) >> IMAGE_TILE_SHIFT;
+  uint64_t tileRows = (height + IMAGE_TILE_MASK) >> IMAGE_TILE_SHIFT;
+  if (layout == IMAGE_LAYOUT_LINEAR) {
+    return tilesPerRow == 0 ? static_cast<uint64_t>(width) * height : 0;
+  }
+  if (tilesPerRow != tiles) {
+    return 0;
+  }
+  if (layout == IMAGE_LAYOUT_TILED) {
+    return tiles * tileRows * IMAGE_TILE_SIZE * IMAGE_TILE_SIZE;
+  }
+  if (BlockCompression::isCompressed(layout)) {
+    return tiles * tileRows * BlockCompression::getBlockBytes(layout) /
+           sizeof(RGBA);
+  }
+  return 0;
+}
+
+Image* TextureCache::mapImage(const std::string& path, uint64_t expectedHash) {
+  auto file = std::make_shared<MappedFile>();
+  if (!file->open(path)) {
+    return nullptr;
+  }
+
+  const byte* data = file->getData();
+  size_t size = file->getSize();
+  if (size < sizeof(TextureCacheHeader)) {
+    return nullptr;
+  }
+
+  const auto* header = reinterpret_cast<const TextureCacheHeader*>(data);
+  if (header->mMagic != TEXTURE_CACHE_MAGIC ||
+      header->mVersion != TEXTURE_CACHE_VERSION || header->mLevels == 0 ||
+      header->mLevels > TEXTURE_CACHE_MAX_LEVELS || header->mLayers == 0 ||
+      header->mLayout == IMAGE_LAYOUT_VIRTUAL ||
+      (expectedHash && header->mSourceHash != expectedHash)) {
+    return nullptr;
+  }
+
+  size_t tableEnd = sizeof(TextureCacheHeader) +
+                    sizeof(TextureCacheLevel) * header->mLevels;
+  if (size < tableEnd) {
+    return nullptr;
+  }
+  const auto* levels =
+      reinterpret_cast<const TextureCacheLevel*>(header + 1);
+
+  // The sampler trusts the geometry, so it must describe exactly the
+  // texels each level holds
+  for (uint32_t i = 0; i < header->mLevels; ++i) {
+    uint64_t layerSize = getLayerSize(header->mLayout, levels[i].mWidth,
+                                      levels[i].mHeight,
+                                      levels[i].mTilesPerRow);
+    if (layerSize == 0 || layerSize != levels[i].mLayerSize ||
+        levels[i].mOffset % TEXTURE_CACHE_ALIGNMENT != 0 ||
+        levels[i].mOffset > size) {
+      return nullptr;
+    }
+
+    uint64_t bytes = layerSize * header->mLayers * sizeof(RGBA);
+    if (bytes > size - levels[i].mOffset) {
+      return nullptr;
+    }
+  }
+
+  // Every level shares the mapping, it is unmapped with the last one
+  auto createLevel = [&](const TextureCacheLevel& level) {
+    auto pixels =
+        reinterpret_cast<RGBA*>(const_cast<byte*>(data + level.mOffset));
+    Image* image = new Image(level.mWidth, level.mHeight, pixels,
+                             [file](RGBA*) {});
+    image->mLayers = header->mLayers;
+    image->mLayout = header->mLayout;
+    image->mLayerSize = level.mLayerSize;
+    image->mTilesPerRow = level.mTilesPerRow;
+    return image;
+  };
+
+  Image* image = createLevel(levels[0]);
+  for (uint32_t i = 1; i < header->mLevels; ++i) {
+    image->mMipmaps.push_back(createLevel(levels[i]));
+  }
+
+  return image;
+}
+
+uint64_t TextureCache::hashData(const byte* data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+bool TextureCache::seekFile(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+  if (offset > static_cast<uint64_t>(std::numeric_limits<__int64>::max())) {
+    return false;
+  }
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  // off_t is 32 bits on 32-bit targets built without _FILE_OFFSET_BITS=64
+  if (offset > static_cast<uint64_t>(std::numeric_limits<off_t>::max())) {
+    return false;
+  }
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
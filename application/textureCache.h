@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdio>
+
+#include "../global/base.h"
+#include "image.h"
+
+// "STEX" in file byte order
+#define TEXTURE_CACHE_MAGIC 0x58455453
+#define TEXTURE_CACHE_VERSION 1
+
+// Pixel data of every level starts on this boundary, so tiled levels keep
+// their cache line alignment once mapped
+#define TEXTURE_CACHE_ALIGNMENT 64
+
+// A full mip chain of a 2^31 texel wide image, more levels mean a corrupt
+// file
+#define TEXTURE_CACHE_MAX_LEVELS 32
+
+// Pre-decoded texture container, native byte order:
+// header, one TextureCacheLevel per mip level, then aligned pixel data in
+// the image's layout (all layers of a level back to back)
+struct TextureCacheHeader {
+  uint32_t mMagic{TEXTURE_CACHE_MAGIC};
+  uint32_t mVersion{TEXTURE_CACHE_VERSION};
+  uint32_t mWidth{0};
+  uint32_t mHeight{0};
+  uint32_t mLevels{0};
+  uint32_t mLayers{0};
+  int32_t mLayout{IMAGE_LAYOUT_LINEAR};
+  uint32_t mReserved{0};
+  uint64_t mSourceHash{0};
+};
+
+struct TextureCacheLevel {
+  uint64_t mOffset{0};
+  uint32_t mWidth{0};
+  uint32_t mHeight{0};
+  uint32_t mLayerSize{0};
+  uint32_t mTilesPerRow{0};
+};
+
+// Source images converted once into the container above, keyed by a hash
+// of the source file content, and mapped straight into Images afterwards
+class TextureCache {
+ public:
+  TextureCache(const std::string& directory,
+               int32_t layout = IMAGE_LAYOUT_LINEAR);
+  ~TextureCache();
+
+  // Map the cached copy of sourcePath, decoding and populating the cache
+  // first if there is none. With IMAGE_LAYOUT_VIRTUAL the copy is paged and
+  // sampled through a VirtualTexture
+  Image* loadImage(const std::string& sourcePath);
+
+  // Resident page memory of each virtual texture loaded from now on
+  void setVirtualBudget(size_t bytes) { mVirtualBudget = bytes; }
+
+  std::string getCachePath(uint64_t sourceHash) const;
+
+  // Write image with its mip chain into a container file
+  static bool writeImage(const Image* image, const std::string& path,
+                         uint64_t sourceHash = 0);
+
+  // Image whose levels point into the mapped file, nothing is decoded.
+  // expectedHash of 0 accepts any source. Paged files are rejected, they
+  // open through VirtualTexture
+  static Image* mapImage(const std::string& path, uint64_t expectedHash = 0);
+
+  // 64-bit FNV-1a
+  static uint64_t hashData(const byte* data, size_t size);
+
+  // fseek to an absolute offset, also past 2GB where long is 32 bits
+  // (LLP64). Shared by the cache file writers
+  static bool seekFile(FILE* file, uint64_t offset);
+
+ private:
+  std::string mDirectory;
+  int32_t mLayout{IMAGE_LAYOUT_LINEAR};
+  size_t mVirtualBudget{64 * 1024 * 1024};
+};
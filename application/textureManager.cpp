@@ -0,0 +1,158 @@
+#include "textureManager.h"
+
+#include <algorithm>
+
+#include "mappedFile.h"
+#include "textureCache.h"
+#include "threadPool.h"
+
+std::unique_ptr<TextureManager> TextureManager::mInstance = nullptr;
+
+TextureManager* TextureManager::getInstance() {
+  static std::once_flag sFlag;
+  std::call_once(sFlag,
+                 []() { mInstance = std::make_unique<TextureManager>(); });
+
+  return mInstance.get();
+}
+
+TextureManager::TextureManager() {}
+
+TextureManager::~TextureManager() {}
+
+TextureHandle TextureManager::load(const std::string& path) {
+  int32_t layout = IMAGE_LAYOUT_LINEAR;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    layout = mLayout;
+    auto it = mPaths.find(path);
+    if (it != mPaths.end()) {
+      auto entry = mEntries.find(EntryKey{it->second, layout});
+      if (entry != mEntries.end()) {
+        entry->second.mLastUse = ++mClock;
+        return entry->second.mImage;
+      }
+    }
+  }
+
+  // Decoding runs unlocked, so that loads of different files overlap
+  MappedFile file;
+  if (!file.open(path)) {
+    return nullptr;
+  }
+  uint64_t hash = TextureCache::hashData(file.getData(), file.getSize());
+
+  EntryKey key{hash, layout};
+  {
+    // Same content under another path
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(key);
+    if (it != mEntries.end()) {
+      mPaths[path] = hash;
+      it->second.mLastUse = ++mClock;
+      return it->second.mImage;
+    }
+  }
+
+  Image* image = Image::createImageFromMemory(file.getData(), file.getSize());
+  if (!image) {
+    return nullptr;
+  }
+  image->setLayout(layout);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // Another thread may have finished the same file meanwhile, keep its copy
+  auto it = mEntries.find(key);
+  if (it != mEntries.end()) {
+    Image::destroyImage(image);
+  } else {
+    Entry entry;
+    entry.mImage = TextureHandle(image, Image::destroyImage);
+    entry.mSize = computeSize(image);
+    mMemoryUsage += entry.mSize;
+    it = mEntries.emplace(key, std::move(entry)).first;
+  }
+
+  mPaths[path] = hash;
+  it->second.mLastUse = ++mClock;
+  TextureHandle handle = it->second.mImage;
+
+  evict(mMemoryCap);
+  return handle;
+}
+
+std::future<TextureHandle> TextureManager::loadAsync(const std::string& path) {
+  return ThreadPool::getShared()->submit(
+      [this, path]() { return load(path); });
+}
+
+void TextureManager::setMemoryCap(size_t bytes) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mMemoryCap = bytes;
+  evict(mMemoryCap);
+}
+
+void TextureManager::setLayout(int32_t layout) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mLayout = layout;
+}
+
+void TextureManager::purge() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  evict(0);
+}
+
+size_t TextureManager::getMemoryUsage() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mMemoryUsage;
+}
+
+size_t TextureManager::getTextureCount() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mEntries.size();
+}
+
+size_t TextureManager::computeSize(const Image* image) {
+  // Virtual images hold a fixed page budget of their own
+  if (image->mLayout == IMAGE_LAYOUT_VIRTUAL) {
+    return 0;
+  }
+
+  size_t size = 0;
+  for (uint32_t i = 0; i < image->getMipLevels(); ++i) {
+    const Image* level = image->getMipmap(i);
+    size += static_cast<size_t>(level->mLayerSize) * level->mLayers *
+            sizeof(RGBA);
+  }
+
+  return size;
+}
+
+void TextureManager::evict(size_t cap) {
+  while (mMemoryUsage > cap) {
+    // Only the registry refers to an unused image
+    auto oldest = mEntries.end();
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+      if (it->second.mImage.use_count() == 1 &&
+          (oldest == mEntries.end() ||
+           it->second.mLastUse < oldest->second.mLastUse)) {
+        oldest = it;
+      }
+    }
+
+    if (oldest == mEntries.end()) {
+      return;
+    }
+
+    uint64_t hash = oldest->first.mHash;
+    mMemoryUsage -= oldest->second.mSize;
+    mEntries.erase(oldest);
+
+    // Paths of content still cached in another layout go too, their next
+    // load finds that copy by content hash
+    for (auto it = mPaths.begin(); it != mPaths.end();) {
+      it = it->second == hash ? mPaths.erase(it) : std::next(it);
+    }
+  }
+}
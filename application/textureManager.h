@@ -0,0 +1,89 @@
+#pragma once
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "../global/base.h"
+#include "image.h"
+
+#define texManager TextureManager::getInstance()
+
+// Shared ownership of a loaded image, released through Image::destroyImage
+using TextureHandle = std::shared_ptr<Image>;
+
+// Registry of loaded images. Repeated loads of a path, or of another path
+// with identical content, return the image already in memory if it is in
+// the current layout. Images no handle refers to any more stay cached until
+// the total size exceeds the memory cap, then the least recently used ones
+// are destroyed. Thread-safe
+class TextureManager {
+ public:
+  static TextureManager* getInstance();
+  TextureManager();
+  ~TextureManager();
+
+  // Empty handle if the file cannot be read or decoded
+  TextureHandle load(const std::string& path);
+
+  // load() on the shared loader threads. The manager must outlive the
+  // returned future
+  std::future<TextureHandle> loadAsync(const std::string& path);
+
+  // Bytes of cached images, unused ones are evicted above it
+  void setMemoryCap(size_t bytes);
+
+  // IMAGE_LAYOUT_* that loads return images in. A file cached in another
+  // layout is decoded again, the two copies are separate entries
+  void setLayout(int32_t layout);
+
+  // Destroy every image no handle refers to
+  void purge();
+
+  size_t getMemoryUsage() const;
+  size_t getTextureCount() const;
+
+ private:
+  struct Entry {
+    TextureHandle mImage;
+    size_t mSize{0};
+    uint64_t mLastUse{0};
+  };
+
+  // Content hash and layout of an entry
+  struct EntryKey {
+    uint64_t mHash;
+    int32_t mLayout;
+
+    bool operator==(const EntryKey& other) const {
+      return mHash == other.mHash && mLayout == other.mLayout;
+    }
+  };
+
+  struct EntryKeyHash {
+    size_t operator()(const EntryKey& key) const {
+      return std::hash<uint64_t>()(key.mHash * 31 +
+                                   static_cast<uint64_t>(key.mLayout));
+    }
+  };
+
+  // Size of all levels and layers held in memory
+  static size_t computeSize(const Image* image);
+
+  // Drop unused entries, oldest first, until usage fits into the cap.
+  // Expects mMutex to be held
+  void evict(size_t cap);
+
+  static std::unique_ptr<TextureManager> mInstance;
+
+  mutable std::mutex mMutex;
+
+  // Content hash and layout -> image, path -> content hash
+  std::unordered_map<EntryKey, Entry, EntryKeyHash> mEntries;
+  std::unordered_map<std::string, uint64_t> mPaths;
+
+  size_t mMemoryUsage{0};
+  size_t mMemoryCap{256 * 1024 * 1024};
+  int32_t mLayout{IMAGE_LAYOUT_LINEAR};
+  uint64_t mClock{0};
+};
@@ -0,0 +1,48 @@
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  for (uint32_t i = 0; i < threadCount; ++i) {
+    mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+ThreadPool* ThreadPool::getShared() {
+  static ThreadPool sPool;
+  return &sPool;
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mCondition.notify_all();
+
+  for (auto& worker : mWorkers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock, [this]() { return mStop || !mTasks.empty(); });
+
+      // Drain the queue before stopping so no future is left unsatisfied
+      if (mTasks.empty()) {
+        return;
+      }
+
+      task = std::move(mTasks.front());
+      mTasks.pop();
+    }
+
+    task();
+  }
+}
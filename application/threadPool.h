@@ -0,0 +1,51 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "../global/base.h"
+
+// Fixed size pool of worker threads running queued tasks in FIFO order
+class ThreadPool {
+ public:
+  // 0 threads means one per hardware thread
+  explicit ThreadPool(uint32_t threadCount = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+
+  template <typename F>
+  auto submit(F&& task) -> std::future<decltype(task())> {
+    using Result = decltype(task());
+
+    auto packaged =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mTasks.emplace([packaged]() { (*packaged)(); });
+    }
+    mCondition.notify_one();
+
+    return future;
+  }
+
+  uint32_t getThreadCount() const {
+    return static_cast<uint32_t>(mWorkers.size());
+  }
+
+  // Pool of the application's loaders, one thread per hardware thread.
+  // Created on first use, lives until exit
+  static ThreadPool* getShared();
+
+ private:
+  void workerLoop();
+
+  std::vector<std::thread> mWorkers;
+  std::queue<std::function<void()>> mTasks;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mStop{false};
+};
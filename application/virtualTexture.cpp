@@ -0,0 +1,212 @@
+#include "virtualTexture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+#include "textureCache.h"
+
+static uint64_t alignOffset(uint64_t offset) {
+  return (offset + VIRTUAL_PAGE_ALIGNMENT - 1) &
+         ~static_cast<uint64_t>(VIRTUAL_PAGE_ALIGNMENT - 1);
+}
+
+static uint32_t pageCount(uint32_t size) {
+  return (size + VIRTUAL_PAGE_MASK) >> VIRTUAL_PAGE_SHIFT;
+}
+
+VirtualTexture::VirtualTexture() {}
+
+VirtualTexture::~VirtualTexture() {}
+
+bool VirtualTexture::open(const std::string& path, size_t memoryBudget) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mLevels.clear();
+  mSlots.clear();
+  mLru.clear();
+  mPageFaults = 0;
+
+  if (!mFile.open(path)) {
+    return false;
+  }
+
+  const byte* data = mFile.getData();
+  size_t size = mFile.getSize();
+  if (size < sizeof(TextureCacheHeader)) {
+    mFile.close();
+    return false;
+  }
+
+  const auto* header = reinterpret_cast<const TextureCacheHeader*>(data);
+  if (header->mMagic != TEXTURE_CACHE_MAGIC ||
+      header->mVersion != TEXTURE_CACHE_VERSION ||
+      header->mLayout != IMAGE_LAYOUT_VIRTUAL || header->mLevels == 0 ||
+      header->mLayers != 1 ||
+      size < sizeof(TextureCacheHeader) +
+                 sizeof(TextureCacheLevel) * header->mLevels) {
+    mFile.close();
+    return false;
+  }
+
+  const auto* levels = reinterpret_cast<const TextureCacheLevel*>(header + 1);
+  for (uint32_t i = 0; i < header->mLevels; ++i) {
+    uint32_t pagesPerRow = pageCount(levels[i].mWidth);
+    uint64_t pages = static_cast<uint64_t>(pagesPerRow) *
+                     pageCount(levels[i].mHeight);
+    uint64_t bytes = pages * VIRTUAL_PAGE_TEXELS * sizeof(RGBA);
+
+    if (levels[i].mTilesPerRow != pagesPerRow ||
+        levels[i].mLayerSize != pages * VIRTUAL_PAGE_TEXELS ||
+        levels[i].mOffset % VIRTUAL_PAGE_ALIGNMENT != 0 ||
+        levels[i].mOffset + bytes > size) {
+      mLevels.clear();
+      mFile.close();
+      return false;
+    }
+
+    Level level;
+    level.mWidth = levels[i].mWidth;
+    level.mHeight = levels[i].mHeight;
+    level.mPagesPerRow = pagesPerRow;
+    level.mOffset = levels[i].mOffset;
+    level.mPageTable.assign(static_cast<size_t>(pages), -1);
+    mLevels.push_back(std::move(level));
+  }
+
+  // A bilinear footprint may straddle four pages
+  size_t pageBytes = VIRTUAL_PAGE_TEXELS * sizeof(RGBA);
+  mMaxSlots = std::max<size_t>(memoryBudget / pageBytes, 4);
+  mSlots.reserve(mMaxSlots);
+  return true;
+}
+
+int32_t VirtualTexture::loadPage(uint32_t level, uint32_t page) const {
+  ++mPageFaults;
+
+  int32_t slot = 0;
+  if (mSlots.size() < mMaxSlots) {
+    slot = static_cast<int32_t>(mSlots.size());
+    mSlots.emplace_back();
+    mSlots.back().mTexels.reset(new RGBA[VIRTUAL_PAGE_TEXELS]);
+    mLru.push_front(slot);
+  } else {
+    // Pool is full, evict the least recently used page
+    slot = mLru.back();
+    mLru.splice(mLru.begin(), mLru, std::prev(mLru.end()));
+    mLevels[mSlots[slot].mLevel].mPageTable[mSlots[slot].mPage] = -1;
+  }
+  mSlots[slot].mLruPosition = mLru.begin();
+
+  size_t pageBytes = VIRTUAL_PAGE_TEXELS * sizeof(RGBA);
+  size_t offset = static_cast<size_t>(mLevels[level].mOffset) +
+                  static_cast<size_t>(page) * pageBytes;
+  memcpy(mSlots[slot].mTexels.get(), mFile.getData() + offset, pageBytes);
+
+  // Drop the file pages the copy was read through, so that resident memory
+  // stays within the pool
+  mFile.discard(offset, pageBytes);
+
+  mSlots[slot].mLevel = level;
+  mSlots[slot].mPage = page;
+  mLevels[level].mPageTable[page] = slot;
+  return slot;
+}
+
+Image* VirtualTexture::createImage(const std::string& path,
+                                   size_t memoryBudget) {
+  auto texture = std::make_shared<VirtualTexture>();
+  if (!texture->open(path, memoryBudget)) {
+    return nullptr;
+  }
+
+  auto createLevel = [&](uint32_t level) {
+    Image* image = new Image(texture->getWidth(level),
+                             texture->getHeight(level));
+    image->mLayout = IMAGE_LAYOUT_VIRTUAL;
+    image->mLayerSize = 0;
+    image->mVirtual = texture;
+    image->mVirtualLevel = level;
+    return image;
+  };
+
+  Image* image = createLevel(0);
+  for (uint32_t i = 1; i < texture->getLevelCount(); ++i) {
+    image->mMipmaps.push_back(createLevel(i));
+  }
+
+  return image;
+}
+
+bool VirtualTexture::writePaged(const Image* image, const std::string& path,
+                                uint64_t sourceHash) {
+  if (!image || image->mWidth == 0 || image->mHeight == 0) {
+    return false;
+  }
+
+  TextureCacheHeader header;
+  header.mWidth = image->mWidth;
+  header.mHeight = image->mHeight;
+  header.mLevels = image->getMipLevels();
+  header.mLayers = 1;
+  header.mLayout = IMAGE_LAYOUT_VIRTUAL;
+  header.mSourceHash = sourceHash;
+
+  std::vector<TextureCacheLevel> levels(header.mLevels);
+  uint64_t offset = alignOffset(sizeof(TextureCacheHeader) +
+                                sizeof(TextureCacheLevel) * header.mLevels);
+  for (uint32_t i = 0; i < header.mLevels; ++i) {
+    const Image* level = image->getMipmap(i);
+    uint32_t pagesPerRow = pageCount(level->mWidth);
+    uint32_t pages = pagesPerRow * pageCount(level->mHeight);
+
+    levels[i].mOffset = offset;
+    levels[i].mWidth = level->mWidth;
+    levels[i].mHeight = level->mHeight;
+    levels[i].mLayerSize = pages * VIRTUAL_PAGE_TEXELS;
+    levels[i].mTilesPerRow = pagesPerRow;
+
+    offset = alignOffset(offset + static_cast<uint64_t>(pages) *
+                                      VIRTUAL_PAGE_TEXELS * sizeof(RGBA));
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  ok = ok && fwrite(levels.data(), sizeof(TextureCacheLevel), levels.size(),
+                    file) == levels.size();
+
+  std::vector<RGBA> page(VIRTUAL_PAGE_TEXELS);
+  for (uint32_t i = 0; ok && i < header.mLevels; ++i) {
+    const Image* level = image->getMipmap(i);
+    ok = TextureCache::seekFile(file, levels[i].mOffset);
+
+    uint32_t pageRows = pageCount(level->mHeight);
+    for (uint32_t py = 0; ok && py < pageRows; ++py) {
+      for (uint32_t px = 0; ok && px < levels[i].mTilesPerRow; ++px) {
+        for (uint32_t y = 0; y < VIRTUAL_PAGE_SIZE; ++y) {
+          uint32_t srcY = std::min((py << VIRTUAL_PAGE_SHIFT) + y,
+                                   level->mHeight - 1);
+          for (uint32_t x = 0; x < VIRTUAL_PAGE_SIZE; ++x) {
+            uint32_t srcX = std::min((px << VIRTUAL_PAGE_SHIFT) + x,
+                                     level->mWidth - 1);
+            page[(y << VIRTUAL_PAGE_SHIFT) + x] = level->getTexel(srcX, srcY);
+          }
+        }
+
+        ok = fwrite(page.data(), sizeof(RGBA), page.size(), file) ==
+             page.size();
+      }
+    }
+  }
+
+  ok = (fclose(file) == 0) && ok;
+  if (!ok) {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+
+  return ok;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstring>
+#include <list>
+#include <mutex>
+
+#include "../global/base.h"
+#include "image.h"
+#include "mappedFile.h"
+
+// Texels per page edge, a 128x128 RGBA page is 64KB
+#define VIRTUAL_PAGE_SIZE 128
+#define VIRTUAL_PAGE_SHIFT 7
+#define VIRTUAL_PAGE_MASK 127
+#define VIRTUAL_PAGE_TEXELS (VIRTUAL_PAGE_SIZE * VIRTUAL_PAGE_SIZE)
+
+// Levels of a paged file start on an OS page boundary so that single pages
+// can be released from the mapping
+#define VIRTUAL_PAGE_ALIGNMENT 4096
+
+// Texture larger than the memory it may use: the texture cache container
+// with IMAGE_LAYOUT_VIRTUAL holds every mip level as fixed-size pages, a
+// bounded pool of pages is kept resident and the least recently used page is
+// evicted when a missing one is needed. Residency is a cache behind the const
+// texel reads, guarded by a mutex so that several threads may sample
+class VirtualTexture {
+ public:
+  VirtualTexture();
+  ~VirtualTexture();
+  VirtualTexture(const VirtualTexture&) = delete;
+
+  // Map a paged container, at most memoryBudget bytes of pages are resident
+  bool open(const std::string& path, size_t memoryBudget);
+
+  // Image whose mip levels sample through the page table of a new
+  // VirtualTexture, nullptr if path is not a paged container
+  static Image* createImage(const std::string& path, size_t memoryBudget);
+
+  // Split image and its mip chain (layer 0) into pages, edge pages are
+  // padded by clamping
+  static bool writePaged(const Image* image, const std::string& path,
+                         uint64_t sourceHash = 0);
+
+  RGBA getTexel(uint32_t level, uint32_t x, uint32_t y) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return *getResidentTexel(level, x, y);
+  }
+
+  // 4x4 block (bx, by) of a level in row order, blocks never straddle pages
+  void getBlock(uint32_t level, uint32_t bx, uint32_t by,
+                RGBA* texels) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const RGBA* row = getResidentTexel(level, bx << IMAGE_TILE_SHIFT,
+                                       by << IMAGE_TILE_SHIFT);
+    for (uint32_t j = 0; j < IMAGE_TILE_SIZE; ++j) {
+      memcpy(texels + j * IMAGE_TILE_SIZE, row + (j << VIRTUAL_PAGE_SHIFT),
+             sizeof(RGBA) * IMAGE_TILE_SIZE);
+    }
+  }
+
+  uint32_t getLevelCount() const {
+    return static_cast<uint32_t>(mLevels.size());
+  }
+  uint32_t getWidth(uint32_t level) const { return mLevels[level].mWidth; }
+  uint32_t getHeight(uint32_t level) const { return mLevels[level].mHeight; }
+
+  size_t getResidentPages() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSlots.size();
+  }
+  size_t getMaxResidentPages() const { return mMaxSlots; }
+  uint64_t getPageFaults() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPageFaults;
+  }
+
+ private:
+  // Texel inside its resident page, paging it in first if needed. Valid
+  // until the next page fault, mMutex must be held
+  const RGBA* getResidentTexel(uint32_t level, uint32_t x,
+                               uint32_t y) const {
+    const Level& info = mLevels[level];
+    uint32_t page = (y >> VIRTUAL_PAGE_SHIFT) * info.mPagesPerRow +
+                    (x >> VIRTUAL_PAGE_SHIFT);
+
+    int32_t slot = info.mPageTable[page];
+    if (slot < 0) {
+      slot = loadPage(level, page);
+    } else {
+      // Most recently used page to the front
+      mLru.splice(mLru.begin(), mLru, mSlots[slot].mLruPosition);
+    }
+
+    return mSlots[slot].mTexels.get() +
+           ((y & VIRTUAL_PAGE_MASK) << VIRTUAL_PAGE_SHIFT) +
+           (x & VIRTUAL_PAGE_MASK);
+  }
+
+  // Bring a page into a free or the least recently used slot
+  int32_t loadPage(uint32_t level, uint32_t page) const;
+
+  struct Level {
+    uint32_t mWidth{0};
+    uint32_t mHeight{0};
+    uint32_t mPagesPerRow{0};
+    uint64_t mOffset{0};
+
+    // Resident slot of every page, -1 while it is paged out
+    mutable std::vector<int32_t> mPageTable;
+  };
+
+  struct Slot {
+    std::unique_ptr<RGBA[]> mTexels;
+    uint32_t mLevel{0};
+    uint32_t mPage{0};
+    std::list<int32_t>::iterator mLruPosition;
+  };
+
+  MappedFile mFile;
+  std::vector<Level> mLevels;
+  size_t mMaxSlots{0};
+
+  // Page residency, changed by the const texel reads
+  mutable std::mutex mMutex;
+  mutable std::vector<Slot> mSlots;
+  // Resident slots, most recently used first
+  mutable std::list<int32_t> mLru;
+  mutable uint64_t mPageFaults{0};
+};
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../application/image.h"
+#include "../gpu/gpu.h"
+
+// Texture and viewport of every scene, power of two so that repeat wrapping
+// is a mask
+#define BENCH_TEXTURE_SIZE 1024
+#define BENCH_VIEWPORT_SIZE 512
+#define BENCH_FRAMES 20
+
+// Modelled L1 data cache: 32KB, 8 ways of 64 byte lines
+#define CACHE_LINE_SHIFT 6
+#define CACHE_WAYS 8
+#define CACHE_SETS 64
+
+// Set associative data cache with LRU replacement, fed with the byte offsets
+// of the texels the bilinear sampler reads
+class CacheModel {
+ public:
+  void access(uint64_t address) {
+    // Tags are stored plus one, 0 marks an empty way
+    uint64_t line = (address >> CACHE_LINE_SHIFT) + 1;
+    uint64_t* set = mTags + (line % CACHE_SETS) * CACHE_WAYS;
+    for (uint32_t way = 0; way < CACHE_WAYS; ++way) {
+      if (set[way] == line) {
+        std::rotate(set, set + way, set + way + 1);
+        ++mHits;
+        return;
+      }
+    }
+
+    std::rotate(set, set + CACHE_WAYS - 1, set + CACHE_WAYS);
+    set[0] = line;
+    ++mMisses;
+  }
+
+  float getHitRate() const {
+    return 100.0f * static_cast<float>(mHits) /
+           static_cast<float>(mHits + mMisses);
+  }
+
+ private:
+  uint64_t mTags[CACHE_SETS * CACHE_WAYS]{};
+  uint64_t mHits{0};
+  uint64_t mMisses{0};
+};
+
+// Viewport to texture mapping: texel space is the viewport rotated by angle
+// degrees around its center and scaled, scale 2 is 2x minification
+struct Scene {
+  const char* mName;
+  float mAngle;
+  float mScale;
+};
+
+static const Scene sScenes[] = {
+    {"upright", 0.0f, 1.0f},     {"rotated 30", 30.0f, 1.0f},
+    {"rotated 45", 45.0f, 1.0f}, {"rotated 90", 90.0f, 1.0f},
+    {"minified 2x", 0.0f, 2.0f}, {"minified 4x 45", 45.0f, 4.0f},
+};
+
+static math::vec2f toTexel(const Scene& scene, float x, float y) {
+  float c = std::cos(DEG2RAD(scene.mAngle)) * scene.mScale;
+  float s = std::sin(DEG2RAD(scene.mAngle)) * scene.mScale;
+  float dx = x - BENCH_VIEWPORT_SIZE * 0.5f;
+  float dy = y - BENCH_VIEWPORT_SIZE * 0.5f;
+  return math::vec2f(BENCH_TEXTURE_SIZE * 0.5f + c * dx - s * dy,
+                     BENCH_TEXTURE_SIZE * 0.5f + s * dx + c * dy);
+}
+
+// Replay the 2x2 footprints of a bilinear, repeat wrapped draw of the scene
+// in raster order
+template <int32_t LAYOUT>
+static float measureHitRate(const Image* image, const Scene& scene) {
+  CacheModel cache;
+  const uint32_t mask = BENCH_TEXTURE_SIZE - 1;
+  for (uint32_t y = 0; y < BENCH_VIEWPORT_SIZE; ++y) {
+    for (uint32_t x = 0; x < BENCH_VIEWPORT_SIZE; ++x) {
+      math::vec2f texel = toTexel(scene, x + 0.5f, y + 0.5f);
+      int32_t x0 = static_cast<int32_t>(std::floor(texel.x - 0.5f));
+      int32_t y0 = static_cast<int32_t>(std::floor(texel.y - 0.5f));
+      for (int32_t j = 0; j < 2; ++j) {
+        for (int32_t i = 0; i < 2; ++i) {
+          uint32_t index = image->getTexelIndex<LAYOUT>((x0 + i) & mask,
+                                                        (y0 + j) & mask);
+          cache.access(static_cast<uint64_t>(index) * sizeof(RGBA));
+        }
+      }
+    }
+  }
+  return cache.getHitRate();
+}
+
+// Milliseconds per frame of drawing the scene as two textured triangles
+static float measureFrameTime(Image* image, const Scene& scene) {
+  const float size = BENCH_VIEWPORT_SIZE;
+  Point corners[4] = {Point(0, 0), Point(BENCH_VIEWPORT_SIZE - 1, 0),
+                      Point(BENCH_VIEWPORT_SIZE - 1, BENCH_VIEWPORT_SIZE - 1),
+                      Point(0, BENCH_VIEWPORT_SIZE - 1)};
+  const float xs[4] = {0.0f, size, size, 0.0f};
+  const float ys[4] = {0.0f, 0.0f, size, size};
+  for (uint32_t i = 0; i < 4; ++i) {
+    corners[i].uv = toTexel(scene, xs[i], ys[i]) / BENCH_TEXTURE_SIZE;
+  }
+
+  sgl->setTexture(image);
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < BENCH_FRAMES; ++frame) {
+    sgl->clear();
+    sgl->drawTriangle(corners[0], corners[1], corners[2]);
+    sgl->drawTriangle(corners[0], corners[2], corners[3]);
+  }
+  std::chrono::duration<float, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / BENCH_FRAMES;
+}
+
+// Data cache hit rate and frame time of sampling a linear and a tiled
+// texture, upright, rotated and minified
+int main() {
+  std::vector<RGBA> texels(BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE);
+  for (uint32_t y = 0; y < BENCH_TEXTURE_SIZE; ++y) {
+    for (uint32_t x = 0; x < BENCH_TEXTURE_SIZE; ++x) {
+      texels[y * BENCH_TEXTURE_SIZE + x] =
+          RGBA(static_cast<byte>(x), static_cast<byte>(y),
+               static_cast<byte>(x ^ y), 255);
+    }
+  }
+
+  Image linear(BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE, texels.data());
+  Image tiled(BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE, texels.data());
+  tiled.setLayout(IMAGE_LAYOUT_TILED);
+
+  sgl->initSurface(BENCH_VIEWPORT_SIZE, BENCH_VIEWPORT_SIZE);
+  sgl->setBilinear(true);
+  sgl->setMipmapMode(TEXTURE_MIPMAP_NONE);
+  sgl->setWrapMode(TEXTURE_WRAP_REPEAT);
+
+  printf("%-16s %14s %14s %12s %12s\n", "scene", "linear hits %",
+         "tiled hits %", "linear ms", "tiled ms");
+  for (const Scene& scene : sScenes) {
+    printf("%-16s %14.2f %14.2f %12.2f %12.2f\n", scene.mName,
+           measureHitRate<IMAGE_LAYOUT_LINEAR>(&linear, scene),
+           measureHitRate<IMAGE_LAYOUT_TILED>(&tiled, scene),
+           measureFrameTime(&linear, scene), measureFrameTime(&tiled, scene));
+  }
+  return 0;
+}
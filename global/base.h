@@ -22,14 +22,22 @@ struct RGBA {
   byte mR;
   byte mA;
 
-  RGBA(byte r = 255, byte g = 255, byte b = 255, byte a = 255) {
-    mR = r;
-    mG = g;
-    mB = b;
-    mA = a;
+  constexpr RGBA(byte r = 255, byte g = 255, byte b = 255, byte a = 255)
+      : mB(b), mG(g), mR(r), mA(a) {}
+
+  // Color from a pixel packed into one word by SIMD code, in memory order:
+  // B in the low byte
+  static constexpr RGBA fromPacked(uint32_t packed) {
+    return RGBA(static_cast<byte>(packed >> 16), static_cast<byte>(packed >> 8),
+                static_cast<byte>(packed), static_cast<byte>(packed >> 24));
   }
 };
 
+// Samples per pixel of the multisampled attachment, bit i of a coverage mask
+// stands for sample i
+#define MSAA_SAMPLES 4
+#define MSAA_COVERAGE_FULL 0xF
+
 struct Point {
   Point(int32_t x = 0, int32_t y = 0, RGBA color = RGBA()) {
     this->x = x;
@@ -41,7 +49,41 @@ struct Point {
   int32_t y;
   RGBA color;
   math::vec2f uv;
+
+  // Texture unit and array layer, flat per triangle (taken from its first
+  // vertex)
+  uint32_t texUnit{0};
+  uint32_t texLayer{0};
+
+  // Samples of the pixel the fragment covers, only less than full on the
+  // edges of multisampled triangles
+  uint8_t coverage{MSAA_COVERAGE_FULL};
 };
 
+#define BLEND_MODE_ALPHA 0
+#define BLEND_MODE_ADDITIVE 1
+
+#define LINE_JOIN_MITER 0
+#define LINE_JOIN_ROUND 1
+#define LINE_JOIN_BEVEL 2
+
+#define LINE_CAP_BUTT 0
+#define LINE_CAP_ROUND 1
+#define LINE_CAP_SQUARE 2
+
 #define TEXTURE_WRAP_REPEAT 0
-#define TEXTURE_WRAP_MIRROR 1
\ No newline at end of file
+#define TEXTURE_WRAP_MIRROR 1
+#define TEXTURE_WRAP_CLAMP_TO_EDGE 2
+
+#define TEXTURE_FILTER_NEAREST 0
+#define TEXTURE_FILTER_LINEAR 1
+
+#define TEXTURE_MIPMAP_NONE 0
+#define TEXTURE_MIPMAP_NEAREST 1
+#define TEXTURE_MIPMAP_LINEAR 2
+
+#define IMAGE_LAYOUT_LINEAR 0
+#define IMAGE_LAYOUT_TILED 1
+#define IMAGE_LAYOUT_VIRTUAL 2
+#define IMAGE_LAYOUT_BC1 3
+#define IMAGE_LAYOUT_BC3 4
\ No newline at end of file
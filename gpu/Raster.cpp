@@ -1,5 +1,11 @@
 #include "Raster.h"
 
+#include <cstring>
+
+#ifdef SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 // Bresenham's line drawing algorithm
 void Raster::rasterizeLine(std::vector<Point>& results, const Point& v0,
                            const Point& v1) {
@@ -82,6 +88,75 @@ void Raster::interpolantLine(const Point& v0, const Point& v1, Point& target) {
   target.color = lerpRGBA(v0.color, v1.color, weight);
 }
 
+bool Raster::clipLine(Point& v0, Point& v1, int32_t minX, int32_t minY,
+                      int32_t maxX, int32_t maxY) {
+  // Segment is v0 + t * delta, t in [0, 1]. Each boundary bounds t from one
+  // side, the inside part is what remains of [0, 1]
+  double deltaX = static_cast<double>(v1.x) - v0.x;
+  double deltaY = static_cast<double>(v1.y) - v0.y;
+  double p[4] = {-deltaX, deltaX, -deltaY, deltaY};
+  double q[4] = {static_cast<double>(v0.x) - minX,
+                 static_cast<double>(maxX) - v0.x,
+                 static_cast<double>(v0.y) - minY,
+                 static_cast<double>(maxY) - v0.y};
+
+  double tEnter = 0.0;
+  double tLeave = 1.0;
+  for (int k = 0; k < 4; ++k) {
+    if (p[k] == 0.0) {
+      // Parallel to this boundary and outside it
+      if (q[k] < 0.0) {
+        return false;
+      }
+      continue;
+    }
+
+    double t = q[k] / p[k];
+    if (p[k] < 0.0) {
+      tEnter = std::max(tEnter, t);
+    } else {
+      tLeave = std::min(tLeave, t);
+    }
+    if (tEnter > tLeave) {
+      return false;
+    }
+  }
+
+  const Point start = v0;
+  const Point end = v1;
+  auto cut = [&](double t) {
+    Point p = start;
+    p.x = static_cast<int32_t>(std::lround(start.x + t * deltaX));
+    p.y = static_cast<int32_t>(std::lround(start.y + t * deltaY));
+    auto weight = static_cast<float>(t);
+    p.color = lerpRGBA(start.color, end.color, weight);
+    p.uv = start.uv * (1.0f - weight) + end.uv * weight;
+    return p;
+  };
+
+  if (tEnter > 0.0) {
+    v0 = cut(tEnter);
+  }
+  if (tLeave < 1.0) {
+    v1 = cut(tLeave);
+  }
+  return true;
+}
+
+// Fill rule for pixels (or samples) exactly on an edge: of two triangles
+// sharing an edge exactly one owns it, so meshes have neither gaps nor double
+// blended pixels along their inner edges. sign makes inside positive
+static bool ownsEdge(const Point& a, const Point& b, float sign) {
+  float dx = static_cast<float>(a.y - b.y) * sign;
+  float dy = static_cast<float>(b.x - a.x) * sign;
+  return dx > 0.0f || (dx == 0.0f && dy > 0.0f);
+}
+
+static bool insideEdge(float edge, float sign, bool owned) {
+  edge *= sign;
+  return edge > 0.0f || (edge == 0.0f && owned);
+}
+
 // Rasterize triangle using bounding box and cross product method
 void Raster::rasterizeTriangle(std::vector<Point>& results, const Point& v0,
                                const Point& v1, const Point& v2) {
@@ -91,6 +166,16 @@ void Raster::rasterizeTriangle(std::vector<Point>& results, const Point& v0,
   int maxY = static_cast<int>(std::max(v0.y, std::max(v1.y, v2.y)));
   int minY = static_cast<int>(std::min(v0.y, std::min(v1.y, v2.y)));
 
+  float area = math::cross(math::vec2f(v1.x - v0.x, v1.y - v0.y),
+                           math::vec2f(v2.x - v0.x, v2.y - v0.y));
+  if (area == 0.0f) {
+    return;
+  }
+  float sign = area > 0.0f ? 1.0f : -1.0f;
+  bool owned1 = ownsEdge(v0, v1, sign);
+  bool owned2 = ownsEdge(v1, v2, sign);
+  bool owned3 = ownsEdge(v2, v0, sign);
+
   // Temp variables: for storing vectors
   math::vec2f pv0, pv1, pv2;
   Point result;
@@ -109,12 +194,11 @@ void Raster::rasterizeTriangle(std::vector<Point>& results, const Point& v0,
       auto cross2 = math::cross(pv1, pv2);
       auto cross3 = math::cross(pv2, pv0);
 
-      // Check if point is inside triangle: same-side method
-      bool negativeAll = cross1 < 0 && cross2 < 0 && cross3 < 0;
-      bool positiveAll = cross1 > 0 && cross2 > 0 && cross3 > 0;
-
-      // If point is inside triangle
-      if (negativeAll || positiveAll) {
+      // Check if point is inside triangle: same-side method, points on an
+      // edge go to the triangle owning it
+      if (insideEdge(cross1, sign, owned1) &&
+          insideEdge(cross2, sign, owned2) &&
+          insideEdge(cross3, sign, owned3)) {
         result.x = i;
         result.y = j;
         // Interpolate color for the pixel
@@ -126,6 +210,103 @@ void Raster::rasterizeTriangle(std::vector<Point>& results, const Point& v0,
   }
 }
 
+// Rotated grid, offsets from the pixel center. No two samples share a row or
+// column, so near-horizontal and near-vertical edges get 4 coverage steps
+static const float kSampleOffsets[MSAA_SAMPLES][2] = {
+    {-0.125f, -0.375f}, {0.375f, -0.125f}, {-0.375f, 0.125f}, {0.125f, 0.375f}};
+
+void Raster::rasterizeTriangleMultisample(std::vector<Point>& results,
+                                          const Point& v0, const Point& v1,
+                                          const Point& v2) {
+  int maxX = static_cast<int>(std::max(v0.x, std::max(v1.x, v2.x)));
+  int minX = static_cast<int>(std::min(v0.x, std::min(v1.x, v2.x)));
+  int maxY = static_cast<int>(std::max(v0.y, std::max(v1.y, v2.y)));
+  int minY = static_cast<int>(std::min(v0.y, std::min(v1.y, v2.y)));
+
+  // Edge functions cross(a - p, b - p) are linear in p, so each sample's
+  // value is the center's plus a per-edge constant. Edge k is opposite
+  // vertex k, which makes edge / area its barycentric weight
+  const Point* a[3] = {&v1, &v2, &v0};
+  const Point* b[3] = {&v2, &v0, &v1};
+  float dx[3], dy[3], offset[3][MSAA_SAMPLES];
+  for (int k = 0; k < 3; ++k) {
+    dx[k] = static_cast<float>(a[k]->y - b[k]->y);
+    dy[k] = static_cast<float>(b[k]->x - a[k]->x);
+    for (int s = 0; s < MSAA_SAMPLES; ++s) {
+      offset[k][s] =
+          dx[k] * kSampleOffsets[s][0] + dy[k] * kSampleOffsets[s][1];
+    }
+  }
+
+  float area = math::cross(math::vec2f(v1.x - v0.x, v1.y - v0.y),
+                           math::vec2f(v2.x - v0.x, v2.y - v0.y));
+  if (area == 0.0f) {
+    return;
+  }
+  // Flip the edges of clockwise triangles so that inside is positive
+  float sign = area > 0.0f ? 1.0f : -1.0f;
+  float oneOverArea = 1.0f / area;
+  bool owned[3];
+  for (int k = 0; k < 3; ++k) {
+    owned[k] = ownsEdge(*a[k], *b[k], sign);
+  }
+
+  Point result;
+  float edge[3];
+  for (int i = minX; i <= maxX; ++i) {
+    for (int j = minY; j <= maxY; ++j) {
+      for (int k = 0; k < 3; ++k) {
+        edge[k] = math::cross(math::vec2f(a[k]->x - i, a[k]->y - j),
+                              math::vec2f(b[k]->x - i, b[k]->y - j));
+      }
+
+      uint8_t coverage = 0;
+      for (int s = 0; s < MSAA_SAMPLES; ++s) {
+        if (insideEdge(edge[0] + offset[0][s], sign, owned[0]) &&
+            insideEdge(edge[1] + offset[1][s], sign, owned[1]) &&
+            insideEdge(edge[2] + offset[2][s], sign, owned[2])) {
+          coverage |= 1 << s;
+        }
+      }
+      if (!coverage) {
+        continue;
+      }
+
+      // Interpolating outside the triangle would extrapolate uv past the
+      // texture edge, move to the covered samples' centroid instead
+      bool centerInside = edge[0] * sign > 0.0f && edge[1] * sign > 0.0f &&
+                          edge[2] * sign > 0.0f;
+      if (!centerInside) {
+        float cx = 0.0f, cy = 0.0f, count = 0.0f;
+        for (int s = 0; s < MSAA_SAMPLES; ++s) {
+          if (coverage & (1 << s)) {
+            cx += kSampleOffsets[s][0];
+            cy += kSampleOffsets[s][1];
+            count += 1.0f;
+          }
+        }
+        cx /= count;
+        cy /= count;
+        for (int k = 0; k < 3; ++k) {
+          edge[k] += dx[k] * cx + dy[k] * cy;
+        }
+      }
+
+      float weight0 = edge[0] * oneOverArea;
+      float weight1 = edge[1] * oneOverArea;
+      float weight2 = edge[2] * oneOverArea;
+
+      result.x = i;
+      result.y = j;
+      result.coverage = coverage;
+      result.color =
+          lerpRGBA(v0.color, v1.color, v2.color, weight0, weight1, weight2);
+      result.uv = lerpUV(v0.uv, v1.uv, v2.uv, weight0, weight1, weight2);
+      results.push_back(result);
+    }
+  }
+}
+
 // Interpolate triangle colors
 void Raster::interpolantTriangle(const Point& v0, const Point& v1,
                                  const Point& v2, Point& p) {
@@ -187,6 +368,111 @@ RGBA Raster::lerpRGBA(const RGBA& c0, const RGBA& c1, const RGBA& c2,
   return result;
 }
 
+#ifdef SIMD_SSE2
+// Filter two pixels held as 16-bit lanes: bottom/top are [pixel0 | pixel1]
+// pairs of left and right texels, weights are broadcast per pixel half
+static inline __m128i bilinearLanes(__m128i leftRight0, __m128i leftRight1,
+                                    __m128i fx, __m128i fy) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(256);
+
+  // leftRightN = [lb rb lt rt] of pixel N as bytes
+  __m128i bottom = _mm_unpacklo_epi64(leftRight0, leftRight1);
+  __m128i top = _mm_unpackhi_epi64(leftRight0, leftRight1);
+
+  // Vertical pass, 16-bit lanes: [lb0 rb0 lb1 rb1] x 4 channels in two regs
+  __m128i bottomLo = _mm_unpacklo_epi8(bottom, zero);
+  __m128i bottomHi = _mm_unpackhi_epi8(bottom, zero);
+  __m128i topLo = _mm_unpacklo_epi8(top, zero);
+  __m128i topHi = _mm_unpackhi_epi8(top, zero);
+
+  __m128i fyLo = _mm_unpacklo_epi64(fy, fy);
+  __m128i fyHi = _mm_unpackhi_epi64(fy, fy);
+
+  // (a * (256 - f) + b * f) >> 8 stays within unsigned 16 bits
+  __m128i colLo = _mm_srli_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(bottomLo, _mm_sub_epi16(one, fyLo)),
+                    _mm_mullo_epi16(topLo, fyLo)),
+      8);
+  __m128i colHi = _mm_srli_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(bottomHi, _mm_sub_epi16(one, fyHi)),
+                    _mm_mullo_epi16(topHi, fyHi)),
+      8);
+
+  // Horizontal pass: [left0 left1] against [right0 right1]
+  __m128i left = _mm_unpacklo_epi64(colLo, colHi);
+  __m128i right = _mm_unpackhi_epi64(colLo, colHi);
+
+  return _mm_srli_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(left, _mm_sub_epi16(one, fx)),
+                    _mm_mullo_epi16(right, fx)),
+      8);
+}
+#else
+// Lerp two packed BGRA texels with the red/blue and alpha/green pairs in
+// separate 16-bit lanes of a 32-bit word
+static inline uint32_t lerpPacked(uint32_t c0, uint32_t c1, uint32_t f) {
+  uint32_t rb = ((c0 & 0x00FF00FF) * (256 - f) + (c1 & 0x00FF00FF) * f) >> 8;
+  uint32_t ag = ((c0 >> 8) & 0x00FF00FF) * (256 - f) +
+                ((c1 >> 8) & 0x00FF00FF) * f;
+  return (rb & 0x00FF00FF) | (ag & 0xFF00FF00);
+}
+#endif
+
+RGBA Raster::bilinearRGBA(const RGBA& leftBottom, const RGBA& rightBottom,
+                          const RGBA& leftTop, const RGBA& rightTop,
+                          uint32_t fx, uint32_t fy) {
+#ifdef SIMD_SSE2
+  RGBA texels[4] = {leftBottom, rightBottom, leftTop, rightTop};
+  __m128i leftRight =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels));
+  __m128i weightX = _mm_set1_epi16(static_cast<short>(fx));
+  __m128i weightY = _mm_set1_epi16(static_cast<short>(fy));
+
+  __m128i color = bilinearLanes(leftRight, leftRight, weightX, weightY);
+  uint32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(color, color));
+#else
+  uint32_t lb, rb, lt, rt;
+  memcpy(&lb, &leftBottom, sizeof(uint32_t));
+  memcpy(&rb, &rightBottom, sizeof(uint32_t));
+  memcpy(&lt, &leftTop, sizeof(uint32_t));
+  memcpy(&rt, &rightTop, sizeof(uint32_t));
+
+  uint32_t packed = lerpPacked(lerpPacked(lb, lt, fy), lerpPacked(rb, rt, fy),
+                               fx);
+#endif
+  return RGBA::fromPacked(packed);
+}
+
+void Raster::bilinearRGBA4(const RGBA* texels, const uint32_t* fx,
+                           const uint32_t* fy, RGBA* results) {
+#ifdef SIMD_SSE2
+  for (int i = 0; i < 4; i += 2) {
+    __m128i leftRight0 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + i * 4));
+    __m128i leftRight1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + i * 4 + 4));
+
+    // Weights of pixel i in the low four lanes, pixel i + 1 in the high four
+    __m128i weightX = _mm_unpacklo_epi64(
+        _mm_set1_epi16(static_cast<short>(fx[i])),
+        _mm_set1_epi16(static_cast<short>(fx[i + 1])));
+    __m128i weightY = _mm_unpacklo_epi64(
+        _mm_set1_epi16(static_cast<short>(fy[i])),
+        _mm_set1_epi16(static_cast<short>(fy[i + 1])));
+
+    __m128i color = bilinearLanes(leftRight0, leftRight1, weightX, weightY);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(results + i),
+                     _mm_packus_epi16(color, color));
+  }
+#else
+  for (int i = 0; i < 4; ++i) {
+    const RGBA* t = texels + i * 4;
+    results[i] = bilinearRGBA(t[0], t[1], t[2], t[3], fx[i], fy[i]);
+  }
+#endif
+}
+
 math::vec2f Raster::lerpUV(const math::vec2f& uv0, const math::vec2f& uv1,
                            const math::vec2f& uv2, float weight0, float weight1,
                            float weight2) {
@@ -12,9 +12,82 @@ class Raster {
 
   static void interpolantLine(const Point& v0, const Point& v1, Point& target);
 
+  // Liang-Barsky: cut the segment v0 v1 to the rectangle [minX, maxX] x
+  // [minY, maxY], color and uv are re-interpolated at the cut points. False
+  // when nothing of it is inside
+  static bool clipLine(Point& v0, Point& v1, int32_t minX, int32_t minY,
+                       int32_t maxX, int32_t maxY);
+
+  // Xiaolin Wu's anti-aliased line. Each step along the major axis covers the
+  // two pixels straddling the exact minor coordinate, coverage is folded into
+  // the alpha of the color handed to plot(x, y, color). Color is interpolated
+  // by adding a per-step delta and pixels go straight to plot, so a segment
+  // costs no allocation and no divide per pixel
+  template <typename PLOT>
+  static void rasterizeLineSmooth(const Point& v0, const Point& v1,
+                                  PLOT&& plot) {
+    int32_t x0 = v0.x, y0 = v0.y, x1 = v1.x, y1 = v1.y;
+    RGBA c0 = v0.color, c1 = v1.color;
+
+    bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if (steep) {
+      std::swap(x0, y0);
+      std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+      std::swap(x0, x1);
+      std::swap(y0, y1);
+      std::swap(c0, c1);
+    }
+
+    int32_t deltaX = x1 - x0;
+    float step = deltaX ? 1.0f / static_cast<float>(deltaX) : 0.0f;
+    float gradient = static_cast<float>(y1 - y0) * step;
+
+    // b, g, r, a like RGBA
+    const byte* start = &c0.mB;
+    const byte* end = &c1.mB;
+    float color[4], deltaColor[4];
+    for (int c = 0; c < 4; ++c) {
+      color[c] = static_cast<float>(start[c]);
+      deltaColor[c] = (static_cast<float>(end[c]) - color[c]) * step;
+    }
+
+    float y = static_cast<float>(y0);
+    for (int32_t x = x0; x <= x1; ++x) {
+      float base = std::floor(y);
+      float fraction = y - base;
+      auto iy = static_cast<int32_t>(base);
+
+      RGBA result(static_cast<byte>(color[2] + 0.5f),
+                  static_cast<byte>(color[1] + 0.5f),
+                  static_cast<byte>(color[0] + 0.5f));
+      result.mA = static_cast<byte>(color[3] * (1.0f - fraction) + 0.5f);
+      steep ? plot(iy, x, result) : plot(x, iy, result);
+
+      result.mA = static_cast<byte>(color[3] * fraction + 0.5f);
+      if (result.mA) {
+        steep ? plot(iy + 1, x, result) : plot(x, iy + 1, result);
+      }
+
+      y += gradient;
+      for (int c = 0; c < 4; ++c) {
+        color[c] += deltaColor[c];
+      }
+    }
+  }
+
   static void rasterizeTriangle(std::vector<Point>& results, const Point& v0,
                                 const Point& v1, const Point& v2);
 
+  // rasterizeTriangle with MSAA_SAMPLES coverage samples per pixel. A pixel
+  // is emitted when any sample is inside, its coverage mask says which ones.
+  // Attributes are interpolated once per pixel, at the center, or at the
+  // centroid of the covered samples when the center is outside
+  static void rasterizeTriangleMultisample(std::vector<Point>& results,
+                                           const Point& v0, const Point& v1,
+                                           const Point& v2);
+
   static void interpolantTriangle(const Point& v0, const Point& v1,
                                   const Point& v2, Point& p);
   static RGBA lerpRGBA(const RGBA& c0, const RGBA& c1, float weight);
@@ -22,6 +95,18 @@ class Raster {
   static RGBA lerpRGBA(const RGBA& c0, const RGBA& c1, const RGBA& c2,
                        float weight0, float weight1, float weight2);
 
+  // Fixed-point bilinear filter of a 2x2 footprint, fx/fy are 8-bit
+  // fractions (0..255) towards right/top. All four channels are filtered at
+  // once in packed 16-bit lanes
+  static RGBA bilinearRGBA(const RGBA& leftBottom, const RGBA& rightBottom,
+                           const RGBA& leftTop, const RGBA& rightTop,
+                           uint32_t fx, uint32_t fy);
+
+  // Four pixel variant, texels holds leftBottom, rightBottom, leftTop,
+  // rightTop for each pixel in turn
+  static void bilinearRGBA4(const RGBA* texels, const uint32_t* fx,
+                            const uint32_t* fy, RGBA* results);
+
   static math::vec2f lerpUV(const math::vec2f& uv0, const math::vec2f& uv1,
                             const math::vec2f& uv2, float weight0,
                             float weight1, float weight2);
@@ -1,5 +1,17 @@
 #include "frameBuffer.h"
 
+#include <algorithm>
+
+#include "../application/srgb.h"
+
+#ifdef SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+// 4x4 ordered dither thresholds in 1/16 steps
+static const uint8_t kBayer4x4[4][4] = {
+    {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
 FrameBuffer::FrameBuffer(uint32_t width, uint32_t height, void* buffer) {
   mWidth = width;
   mHeight = height;
@@ -18,4 +30,178 @@ FrameBuffer::~FrameBuffer() {
   if (!mExternBuffer && mColorBuffer) {
     delete[] mColorBuffer;
   }
+  setHDR(false);
+  setMultisample(false);
+}
+
+void FrameBuffer::setHDR(bool enable) {
+  if (enable && !mHDRBuffer) {
+    mHDRBuffer = new float[static_cast<size_t>(mWidth) * mHeight * 4]();
+  } else if (!enable && mHDRBuffer) {
+    delete[] mHDRBuffer;
+    mHDRBuffer = nullptr;
+  }
+}
+
+void FrameBuffer::setMultisample(bool enable) {
+  size_t pixelSize = static_cast<size_t>(mWidth) * mHeight;
+  if (enable && !mSampleBuffer) {
+    mSampleBuffer = new RGBA[pixelSize * MSAA_SAMPLES];
+    mSampleCompressed = new byte[pixelSize];
+
+    // Starts out as a copy of the color buffer
+    for (size_t i = 0; i < pixelSize; ++i) {
+      mSampleBuffer[i * MSAA_SAMPLES] = mColorBuffer[i];
+    }
+    std::fill_n(mSampleCompressed, pixelSize, 1);
+  } else if (!enable && mSampleBuffer) {
+    delete[] mSampleBuffer;
+    delete[] mSampleCompressed;
+    mSampleBuffer = nullptr;
+    mSampleCompressed = nullptr;
+  }
+}
+
+void FrameBuffer::resolveMultisample() {
+  if (!mSampleBuffer) {
+    return;
+  }
+  mResolvePending = false;
+
+  size_t pixelSize = static_cast<size_t>(mWidth) * mHeight;
+  for (size_t i = 0; i < pixelSize; ++i) {
+    const RGBA* samples = mSampleBuffer + i * MSAA_SAMPLES;
+    if (mSampleCompressed[i]) {
+      mColorBuffer[i] = samples[0];
+      continue;
+    }
+
+    if (mSRGB) {
+      mColorBuffer[i] =
+          SRGB::average(samples[0], samples[1], samples[2], samples[3]);
+      continue;
+    }
+
+#ifdef SIMD_SSE2
+    // All four samples in one register, summed as 16-bit lanes
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples));
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi8(v, zero),
+                                _mm_unpackhi_epi8(v, zero));
+    sum = _mm_add_epi16(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+    mColorBuffer[i] = RGBA::fromPacked(
+        static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum))));
+#else
+    auto average = [samples](byte RGBA::*channel) {
+      return static_cast<byte>(
+          (samples[0].*channel + samples[1].*channel + samples[2].*channel +
+           samples[3].*channel + 2) >> 2);
+    };
+    mColorBuffer[i] = RGBA(average(&RGBA::mR), average(&RGBA::mG),
+                           average(&RGBA::mB), average(&RGBA::mA));
+#endif
+  }
+}
+
+// Scalar reference of the SSE2 path below
+static RGBA resolvePixel(const float* src, float exposure, float dither,
+                         bool srgb) {
+  float tone[3];
+  for (int c = 0; c < 3; ++c) {
+    float x = std::max(src[c] * exposure, 0.0f);
+    tone[c] = x / (1.0f + x);
+  }
+  auto alpha = static_cast<byte>(
+      std::min(std::max(src[3], 0.0f), 1.0f) * 255.0f + 0.5f);
+
+  if (srgb) {
+    return RGBA(SRGB::encode(tone[2]), SRGB::encode(tone[1]),
+                SRGB::encode(tone[0]), alpha);
+  }
+
+  auto quantize = [dither](float v) {
+    return static_cast<byte>(std::min(v * 255.0f + dither, 255.0f));
+  };
+  return RGBA(quantize(tone[2]), quantize(tone[1]), quantize(tone[0]), alpha);
+}
+
+void FrameBuffer::resolveHDR(float exposure) {
+  if (!mHDRBuffer) {
+    return;
+  }
+  mResolvePending = false;
+
+  for (uint32_t y = 0; y < mHeight; ++y) {
+    const float* src = mHDRBuffer + static_cast<size_t>(y) * mWidth * 4;
+    RGBA* dst = mColorBuffer + static_cast<size_t>(y) * mWidth;
+    uint32_t x = 0;
+
+#ifdef SIMD_SSE2
+    const __m128 scale = _mm_set1_ps(exposure);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+    // Reinhard x / (1 + x) on color, clamped alpha. The approximate
+    // reciprocal is exact enough for 8-bit output
+    auto toneMap = [&](const float* pixel) {
+      __m128 v = _mm_max_ps(_mm_loadu_ps(pixel), zero);
+      __m128 x = _mm_mul_ps(v, scale);
+      __m128 tone = _mm_mul_ps(x, _mm_rcp_ps(_mm_add_ps(one, x)));
+      return _mm_or_ps(_mm_and_ps(alphaMask, _mm_min_ps(v, one)),
+                       _mm_andnot_ps(alphaMask, _mm_min_ps(tone, one)));
+    };
+
+    if (mSRGB) {
+      // Color goes through the encode table, alpha is just rounded
+      const byte* table = SRGB::getEncodeTable();
+      const __m128 indexScale = _mm_set_ps(255.0f, SRGB_ENCODE_TABLE_SIZE - 1,
+                                           SRGB_ENCODE_TABLE_SIZE - 1,
+                                           SRGB_ENCODE_TABLE_SIZE - 1);
+      const __m128 half = _mm_set1_ps(0.5f);
+      alignas(16) int32_t index[4];
+      for (; x < mWidth; ++x) {
+        __m128 tone = toneMap(src + x * 4);
+        _mm_store_si128(
+            reinterpret_cast<__m128i*>(index),
+            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(tone, indexScale), half)));
+        dst[x] = RGBA(table[index[2]], table[index[1]], table[index[0]],
+                      static_cast<byte>(index[3]));
+      }
+    } else {
+      const __m128 max = _mm_set1_ps(255.0f);
+
+      // Dither of the four pixels in this row, alpha is just rounded
+      __m128 dither[4];
+      for (int k = 0; k < 4; ++k) {
+        float d = (static_cast<float>(kBayer4x4[y & 3][k]) + 0.5f) / 16.0f;
+        dither[k] = _mm_set_ps(0.5f, d, d, d);
+      }
+
+      auto quantize = [&](const float* pixel, const __m128& d) {
+        __m128 v = _mm_add_ps(_mm_mul_ps(toneMap(pixel), max), d);
+        return _mm_cvttps_epi32(_mm_min_ps(v, max));
+      };
+
+      for (; x + 4 <= mWidth; x += 4) {
+        const float* pixel = src + x * 4;
+        __m128i p0 = quantize(pixel, dither[0]);
+        __m128i p1 = quantize(pixel + 4, dither[1]);
+        __m128i p2 = quantize(pixel + 8, dither[2]);
+        __m128i p3 = quantize(pixel + 12, dither[3]);
+
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                          _mm_packs_epi32(p2, p3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), packed);
+      }
+    }
+#endif
+
+    for (; x < mWidth; ++x) {
+      float dither =
+          (static_cast<float>(kBayer4x4[y & 3][x & 3]) + 0.5f) / 16.0f;
+      dst[x] = resolvePixel(src + x * 4, exposure, dither, mSRGB);
+    }
+  }
 }
@@ -7,8 +7,40 @@ class FrameBuffer {
   ~FrameBuffer();
   FrameBuffer(const FrameBuffer&) = delete;
 
+  // Allocate or free the RGBA32F accumulation attachment
+  void setHDR(bool enable);
+
+  // Tone-map (Reinhard, scaled by exposure) and dither the HDR attachment
+  // into the color buffer
+  void resolveHDR(float exposure = 1.0f);
+
+  // Allocate or free the MSAA_SAMPLES times multisampled attachment
+  void setMultisample(bool enable);
+
+  // Average each pixel's samples into the color buffer
+  void resolveMultisample();
+
   uint32_t mWidth{0};
   uint32_t mHeight{0};
   RGBA* mColorBuffer{nullptr};
   bool mExternBuffer{false};
+
+  // Color buffer holds sRGB encoded values, blending decodes them first
+  bool mSRGB{false};
+
+  // Optional float color attachment, 4 floats per pixel in RGBA member
+  // order (b, g, r, a). Values are linear, 1.0 is the brightest 8-bit color,
+  // alpha is kept in 0..1 when resolving
+  float* mHDRBuffer{nullptr};
+
+  // Optional multisampled color attachment, MSAA_SAMPLES colors per pixel.
+  // A pixel whose samples are all equal is stored compressed: only its first
+  // sample is valid and mSampleCompressed is set, so that clears and fully
+  // covered writes touch one sample instead of all of them
+  RGBA* mSampleBuffer{nullptr};
+  byte* mSampleCompressed{nullptr};
+
+  // The active attachment was drawn to since it was last resolved, the
+  // color buffer does not hold the frame yet
+  bool mResolvePending{false};
 };
\ No newline at end of file
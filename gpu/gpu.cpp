@@ -1,9 +1,15 @@
 #include "gpu.h"
 
+#include <cstring>
 #include <mutex>
 
+#include "../application/srgb.h"
 #include "Raster.h"
 
+#ifdef SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 std::unique_ptr<GPU> GPU::mInstance = nullptr;
 
 GPU* GPU::getInstance() {
@@ -29,6 +35,18 @@ void GPU::initSurface(const uint32_t& width, const uint32_t& height,
 void GPU::clear() {
   size_t pixelSize = mFrameBuffer->mWidth * mFrameBuffer->mHeight;
   std::fill_n(mFrameBuffer->mColorBuffer, pixelSize, RGBA(0, 0, 0, 0));
+  if (mFrameBuffer->mHDRBuffer) {
+    std::fill_n(mFrameBuffer->mHDRBuffer, pixelSize * 4, 0.0f);
+  }
+  if (mFrameBuffer->mSampleBuffer) {
+    // Only the first sample of a compressed pixel is read
+    for (size_t i = 0; i < pixelSize; ++i) {
+      mFrameBuffer->mSampleBuffer[i * MSAA_SAMPLES] = RGBA(0, 0, 0, 0);
+    }
+    std::fill_n(mFrameBuffer->mSampleCompressed, pixelSize, 1);
+  }
+  mFrameBuffer->mResolvePending =
+      mFrameBuffer->mHDRBuffer || mFrameBuffer->mSampleBuffer;
 }
 
 void GPU::drawPoint(const uint32_t& x, const uint32_t& y, const RGBA& color) {
@@ -38,28 +56,361 @@ void GPU::drawPoint(const uint32_t& x, const uint32_t& y, const RGBA& color) {
 
   uint32_t pixelPos = y * mFrameBuffer->mWidth + x;
 
-  RGBA result = color;
+  if (mFrameBuffer->mSampleBuffer) {
+    drawPointSamples(pixelPos, color, MSAA_COVERAGE_FULL);
+    return;
+  }
+
+  if (mFrameBuffer->mHDRBuffer) {
+    drawPointHDR(mFrameBuffer->mHDRBuffer + pixelPos * 4, color);
+    return;
+  }
+
+  RGBA& dst = mFrameBuffer->mColorBuffer[pixelPos];
+  dst = mEnableBlending ? blend(color, dst) : color;
+}
+
+RGBA GPU::blend(const RGBA& src, const RGBA& dst) const {
+  if (mBlendMode == BLEND_MODE_ADDITIVE) {
+    uint32_t weight = src.mA;
+    auto add = [weight](byte s, byte d) {
+      return static_cast<byte>(std::min(d + (s * weight + 127) / 255, 255u));
+    };
+    return RGBA(add(src.mR, dst.mR), add(src.mG, dst.mG), add(src.mB, dst.mB),
+                add(src.mA, dst.mA));
+  }
+
+  if (mFrameBuffer->mSRGB) {
+    return SRGB::blend(src, dst);
+  }
+
+  RGBA result;
+  float weight = static_cast<float>(src.mA) / 255.0f;
+  result.mR = static_cast<float>(src.mR) * weight +
+              static_cast<float>(dst.mR) * (1.0f - weight);
+  result.mG = static_cast<float>(src.mG) * weight +
+              static_cast<float>(dst.mG) * (1.0f - weight);
+  result.mB = static_cast<float>(src.mB) * weight +
+              static_cast<float>(dst.mB) * (1.0f - weight);
+  result.mA = static_cast<float>(src.mA) * weight +
+              static_cast<float>(dst.mA) * (1.0f - weight);
+  return result;
+}
+
+void GPU::drawPointSamples(uint32_t pixelPos, const RGBA& color,
+                           uint8_t coverage) {
+  RGBA* samples = mFrameBuffer->mSampleBuffer + pixelPos * MSAA_SAMPLES;
+  byte& compressed = mFrameBuffer->mSampleCompressed[pixelPos];
+  mFrameBuffer->mResolvePending = true;
+
+  // Every sample gets the same result, the pixel stays compressed
+  if (compressed && coverage == MSAA_COVERAGE_FULL) {
+    samples[0] = mEnableBlending ? blend(color, samples[0]) : color;
+    return;
+  }
+
+  if (compressed) {
+    samples[1] = samples[2] = samples[3] = samples[0];
+    compressed = 0;
+  }
+
+  for (int s = 0; s < MSAA_SAMPLES; ++s) {
+    if (coverage & (1 << s)) {
+      samples[s] = mEnableBlending ? blend(color, samples[s]) : color;
+    }
+  }
+
+  // Overwritten by one color, e.g. the interior side of a shared edge
+  if (coverage == MSAA_COVERAGE_FULL && !mEnableBlending) {
+    compressed = 1;
+  }
+}
+
+void GPU::drawFragment(const Point& p, const RGBA& color) {
+  if (!mFrameBuffer->mSampleBuffer) {
+    drawPoint(p.x, p.y, color);
+    return;
+  }
+
+  if (static_cast<uint32_t>(p.x) >= mFrameBuffer->mWidth ||
+      static_cast<uint32_t>(p.y) >= mFrameBuffer->mHeight) {
+    return;
+  }
+  drawPointSamples(p.y * mFrameBuffer->mWidth + p.x, color, p.coverage);
+}
+
+void GPU::drawPointHDR(float* dst, const RGBA& color) {
+  mFrameBuffer->mResolvePending = true;
+
+  // Linear light, in b, g, r, a order like RGBA
+  float src[4];
+  if (mFrameBuffer->mSRGB) {
+    src[0] = SRGB::decode(color.mB);
+    src[1] = SRGB::decode(color.mG);
+    src[2] = SRGB::decode(color.mR);
+  } else {
+    src[0] = static_cast<float>(color.mB) / 255.0f;
+    src[1] = static_cast<float>(color.mG) / 255.0f;
+    src[2] = static_cast<float>(color.mR) / 255.0f;
+  }
+  src[3] = static_cast<float>(color.mA) / 255.0f;
+
+  if (!mEnableBlending) {
+    memcpy(dst, src, sizeof(src));
+  } else if (mBlendMode == BLEND_MODE_ADDITIVE) {
+    for (int c = 0; c < 4; ++c) {
+      dst[c] += src[c] * src[3];
+    }
+  } else {
+    float weight = src[3];
+    for (int c = 0; c < 4; ++c) {
+      dst[c] = src[c] * weight + dst[c] * (1.0f - weight);
+    }
+  }
+}
+
+// Pixels [first, last] whose centers lie in [center - radius, center +
+// radius) along one axis, clipped to [0, limit)
+static inline bool pointSpan(float center, float radius, int32_t limit,
+                             int32_t& first, int32_t& last) {
+  // ceil without a libm call, the values are clamped into int range first
+  auto ceilClamped = [limit](float v) {
+    v = std::min(std::max(v, 0.0f), static_cast<float>(limit));
+    auto i = static_cast<int32_t>(v);
+    return i + (static_cast<float>(i) < v);
+  };
+  first = ceilClamped(center - radius);
+  last = ceilClamped(center + radius) - 1;
+  return first <= last;
+}
 
-  if (mEnableBlending) {
-    auto src = color;
-    auto dst = mFrameBuffer->mColorBuffer[pixelPos];
-    float weight = static_cast<float>(src.mA) / 255.0f;
+// (src * a + dst * (255 - a)) / 255 per channel, a is src alpha. Truncates
+// like the float blend of drawPoint
+static inline uint32_t blendChannel(uint32_t src, uint32_t dst, uint32_t a) {
+  uint32_t t = src * a + dst * (255 - a) + 1;
+  return (t + (t >> 8)) >> 8;
+}
 
-    result.mR = static_cast<float>(src.mR) * weight +
-                static_cast<float>(dst.mR) * (1.0f - weight);
-    result.mG = static_cast<float>(src.mG) * weight +
-                static_cast<float>(dst.mG) * (1.0f - weight);
-    result.mB = static_cast<float>(src.mB) * weight +
-                static_cast<float>(dst.mB) * (1.0f - weight);
-    result.mA = static_cast<float>(src.mA) * weight +
-                static_cast<float>(dst.mA) * (1.0f - weight);
+static void fillSpan(RGBA* dst, int32_t count, const RGBA& color) {
+  int32_t i = 0;
+#ifdef SIMD_SSE2
+  uint32_t packed;
+  memcpy(&packed, &color, sizeof(RGBA));
+  __m128i color4 = _mm_set1_epi32(static_cast<int32_t>(packed));
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), color4);
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = color;
+  }
+}
+
+static void blendSpan(RGBA* dst, int32_t count, const RGBA& color) {
+  int32_t i = 0;
+  uint32_t a = color.mA;
+#ifdef SIMD_SSE2
+  uint32_t packed;
+  memcpy(&packed, &color, sizeof(RGBA));
+  const __m128i zero = _mm_setzero_si128();
+  // Two pixels per register in 16-bit lanes
+  __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int32_t>(packed)),
+                                  zero);
+  __m128i srcWeight = _mm_set1_epi16(static_cast<int16_t>(a));
+  __m128i srcWeighted =
+      _mm_add_epi16(_mm_mullo_epi16(src, srcWeight), _mm_set1_epi16(1));
+  __m128i dstWeight = _mm_set1_epi16(static_cast<int16_t>(255 - a));
+  auto blend2 = [&](__m128i d) {
+    __m128i t = _mm_add_epi16(srcWeighted, _mm_mullo_epi16(d, dstWeight));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+  };
+  for (; i + 4 <= count; i += 4) {
+    __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+    __m128i d = _mm_loadu_si128(p);
+    __m128i lo = blend2(_mm_unpacklo_epi8(d, zero));
+    __m128i hi = blend2(_mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < count; ++i) {
+    RGBA& d = dst[i];
+    d = RGBA(blendChannel(color.mR, d.mR, a), blendChannel(color.mG, d.mG, a),
+             blendChannel(color.mB, d.mB, a), blendChannel(color.mA, d.mA, a));
+  }
+}
+
+void GPU::drawPoints(const float* xs, const float* ys, const RGBA* colors,
+                     const float* sizes, size_t count) {
+  auto width = static_cast<int32_t>(mFrameBuffer->mWidth);
+  auto height = static_cast<int32_t>(mFrameBuffer->mHeight);
+
+  // Attachments and blend modes other than plain alpha go through drawPoint
+  bool direct = !mFrameBuffer->mSampleBuffer && !mFrameBuffer->mHDRBuffer &&
+                (!mEnableBlending ||
+                 (mBlendMode == BLEND_MODE_ALPHA && !mFrameBuffer->mSRGB));
+
+  // Point i clipped to [clipX0, clipX1] x [clipY0, clipY1]
+  auto draw = [&](size_t i, const PointRect& rect, int32_t clipX0,
+                  int32_t clipY0, int32_t clipX1, int32_t clipY1) {
+    int32_t rowFirst = std::max(rect.mY0, clipY0);
+    int32_t rowLast = std::min(rect.mY1, clipY1);
+
+    if (!mRoundPoints) {
+      int32_t x0 = std::max(rect.mX0, clipX0);
+      int32_t x1 = std::min(rect.mX1, clipX1);
+      for (int32_t y = rowFirst; y <= rowLast; ++y) {
+        drawPointSpan(y, x0, x1, colors[i], direct);
+      }
+      return;
+    }
+
+    // Disc: each row spans the pixel centers within the circle
+    float radius = (sizes ? sizes[i] : 1.0f) * 0.5f;
+    int32_t x0, x1;
+    for (int32_t y = rowFirst; y <= rowLast; ++y) {
+      float dy = static_cast<float>(y) - ys[i];
+      float halfSquared = radius * radius - dy * dy;
+      if (halfSquared < 0.0f ||
+          !pointSpan(xs[i], std::sqrt(halfSquared), width, x0, x1)) {
+        continue;
+      }
+      x0 = std::max(x0, clipX0);
+      x1 = std::min(x1, clipX1);
+      if (x0 <= x1) {
+        drawPointSpan(y, x0, x1, colors[i], direct);
+      }
+    }
+  };
+
+  // Single pixels gain no locality from binning, a sparse point misses the
+  // cache in either order
+  if (!sizes) {
+    PointRect rect;
+    for (size_t i = 0; i < count; ++i) {
+      if (!pointSpan(xs[i], 0.5f, width, rect.mX0, rect.mX1) ||
+          !pointSpan(ys[i], 0.5f, height, rect.mY0, rect.mY1)) {
+        continue;
+      }
+      if (mRoundPoints || !direct) {
+        draw(i, rect, 0, 0, width - 1, height - 1);
+        continue;
+      }
+
+      RGBA& dst = mFrameBuffer->mColorBuffer[rect.mY0 * width + rect.mX0];
+      const RGBA& color = colors[i];
+      if (!mEnableBlending || color.mA == 255) {
+        dst = color;
+      } else {
+        dst = RGBA(blendChannel(color.mR, dst.mR, color.mA),
+                   blendChannel(color.mG, dst.mG, color.mA),
+                   blendChannel(color.mB, dst.mB, color.mA),
+                   blendChannel(color.mA, dst.mA, color.mA));
+      }
+    }
+    return;
+  }
+
+  // Counting sort of points into every tile they touch, stable so that
+  // each tile keeps submission order
+  uint32_t tilesX = (mFrameBuffer->mWidth + POINT_TILE_SIZE - 1) >>
+                    POINT_TILE_SHIFT;
+  uint32_t tilesY = (mFrameBuffer->mHeight + POINT_TILE_SIZE - 1) >>
+                    POINT_TILE_SHIFT;
+  mPointRects.resize(count);
+  mPointBinStart.assign(tilesX * tilesY + 1, 0);
+  for (size_t i = 0; i < count; ++i) {
+    PointRect& rect = mPointRects[i];
+    float radius = sizes[i] * 0.5f;
+    if (!pointSpan(xs[i], radius, width, rect.mX0, rect.mX1) ||
+        !pointSpan(ys[i], radius, height, rect.mY0, rect.mY1)) {
+      rect.mX1 = -1;
+      continue;
+    }
+    for (int32_t ty = rect.mY0 >> POINT_TILE_SHIFT;
+         ty <= rect.mY1 >> POINT_TILE_SHIFT; ++ty) {
+      for (int32_t tx = rect.mX0 >> POINT_TILE_SHIFT;
+           tx <= rect.mX1 >> POINT_TILE_SHIFT; ++tx) {
+        ++mPointBinStart[ty * tilesX + tx + 1];
+      }
+    }
+  }
+  for (size_t t = 1; t < mPointBinStart.size(); ++t) {
+    mPointBinStart[t] += mPointBinStart[t - 1];
+  }
+
+  mPointBins.resize(mPointBinStart.back());
+  mPointBinCursor.assign(mPointBinStart.begin(), mPointBinStart.end() - 1);
+  for (size_t i = 0; i < count; ++i) {
+    const PointRect& rect = mPointRects[i];
+    if (rect.mX1 < 0) {
+      continue;
+    }
+    for (int32_t ty = rect.mY0 >> POINT_TILE_SHIFT;
+         ty <= rect.mY1 >> POINT_TILE_SHIFT; ++ty) {
+      for (int32_t tx = rect.mX0 >> POINT_TILE_SHIFT;
+           tx <= rect.mX1 >> POINT_TILE_SHIFT; ++tx) {
+        mPointBins[mPointBinCursor[ty * tilesX + tx]++] =
+            static_cast<uint32_t>(i);
+      }
+    }
+  }
+
+  for (uint32_t tile = 0; tile < tilesX * tilesY; ++tile) {
+    int32_t tileX0 = static_cast<int32_t>(tile % tilesX) << POINT_TILE_SHIFT;
+    int32_t tileY0 = static_cast<int32_t>(tile / tilesX) << POINT_TILE_SHIFT;
+    int32_t tileX1 = std::min(tileX0 + POINT_TILE_SIZE, width) - 1;
+    int32_t tileY1 = std::min(tileY0 + POINT_TILE_SIZE, height) - 1;
+
+    for (uint32_t b = mPointBinStart[tile]; b < mPointBinStart[tile + 1];
+         ++b) {
+      uint32_t i = mPointBins[b];
+      draw(i, mPointRects[i], tileX0, tileY0, tileX1, tileY1);
+    }
+  }
+}
+
+void GPU::drawPointSpan(int32_t y, int32_t x0, int32_t x1, const RGBA& color,
+                        bool direct) {
+  if (!direct) {
+    for (int32_t x = x0; x <= x1; ++x) {
+      drawPoint(static_cast<uint32_t>(x), static_cast<uint32_t>(y), color);
+    }
+    return;
+  }
+
+  RGBA* row = mFrameBuffer->mColorBuffer +
+              static_cast<size_t>(y) * mFrameBuffer->mWidth + x0;
+  if (!mEnableBlending || color.mA == 255) {
+    fillSpan(row, x1 - x0 + 1, color);
+  } else if (color.mA) {
+    blendSpan(row, x1 - x0 + 1, color);
   }
-  mFrameBuffer->mColorBuffer[pixelPos] = result;
 }
 
 void GPU::drawLine(const Point& p1, const Point& p2) {
+  // Only the visible part is rasterized, instead of walking the whole
+  // segment and dropping pixels in drawPoint
+  Point start = p1;
+  Point end = p2;
+  if (!Raster::clipLine(start, end, 0, 0,
+                        static_cast<int32_t>(mFrameBuffer->mWidth) - 1,
+                        static_cast<int32_t>(mFrameBuffer->mHeight) - 1)) {
+    return;
+  }
+
+  if (mLineSmooth) {
+    bool blending = mEnableBlending;
+    mEnableBlending = true;
+    Raster::rasterizeLineSmooth(
+        start, end, [this](int32_t x, int32_t y, const RGBA& color) {
+          drawPoint(static_cast<uint32_t>(x), static_cast<uint32_t>(y), color);
+        });
+    mEnableBlending = blending;
+    return;
+  }
+
   std::vector<Point> pixels;
-  Raster::rasterizeLine(pixels, p1, p2);
+  Raster::rasterizeLine(pixels, start, end);
 
   for (auto& p : pixels) {
     drawPoint(p.x, p.y, p.color);
@@ -68,25 +419,240 @@ void GPU::drawLine(const Point& p1, const Point& p2) {
 
 void GPU::drawTriangle(const Point& p1, const Point& p2, const Point& p3) {
   std::vector<Point> pixels;
-  Raster::rasterizeTriangle(pixels, p1, p2, p3);
+  renderTriangle(pixels, p1, p2, p3);
+}
 
-  RGBA resultColor;
-  for (auto& p : pixels) {
-    if (mImage) {
-      resultColor =
-          mEnableBilinear ? sampleBilinear(p.uv) : sampleNearest(p.uv);
-    } else {
-      resultColor = p.color;
+void GPU::drawTriangles(const std::vector<Point>& vertices) {
+  // One fragment buffer for the whole batch
+  std::vector<Point> pixels;
+  for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+    pixels.clear();
+    renderTriangle(pixels, vertices[i], vertices[i + 1], vertices[i + 2]);
+  }
+}
+
+void GPU::renderTriangle(std::vector<Point>& pixels, const Point& p1,
+                         const Point& p2, const Point& p3) {
+  if (mFrameBuffer->mSampleBuffer) {
+    Raster::rasterizeTriangleMultisample(pixels, p1, p2, p3);
+  } else {
+    Raster::rasterizeTriangle(pixels, p1, p2, p3);
+  }
+
+  const Sampler* sampler = nullptr;
+  if (p1.texUnit < MAX_TEXTURE_UNITS) {
+    sampler = &mSamplers[p1.texUnit];
+  }
+
+  const Image* image = sampler ? sampler->getImage() : nullptr;
+  if (!image) {
+    for (auto& p : pixels) {
+      drawFragment(p, p.color);
+    }
+    return;
+  }
+
+  float lod = computeLOD(image, p1, p2, p3);
+  uint32_t layer = std::min(p1.texLayer, image->mLayers - 1);
+
+  // Textured fragments are sampled four at a time
+  size_t i = 0;
+  math::vec2f uvs[4];
+  RGBA colors[4];
+  for (; i + 4 <= pixels.size(); i += 4) {
+    for (int k = 0; k < 4; ++k) {
+      uvs[k] = pixels[i + k].uv;
+    }
+
+    sampler->sample4(uvs, lod, colors, layer);
+
+    for (int k = 0; k < 4; ++k) {
+      drawFragment(pixels[i + k], colors[k]);
+    }
+  }
+
+  for (; i < pixels.size(); ++i) {
+    drawFragment(pixels[i], sampler->sample(pixels[i].uv, lod, layer));
+  }
+}
+
+void GPU::drawPolyline(const std::vector<Point>& points) {
+  mStrokeVertices.clear();
+  Stroke::tessellate(points, mLineWidth, mLineJoin, mLineCap, mStrokeVertices);
+  drawTriangles(mStrokeVertices);
+}
+
+void GPU::drawVertexStream(const VertexStream& stream,
+                           const math::Mat4f& transform, uint32_t texUnit) {
+  size_t count = stream.size() - stream.size() % 3;
+  if (count == 0) {
+    return;
+  }
+
+  // Whole batches, the padding of stream is valid input
+  size_t lanes = (count + VERTEX_STREAM_BATCH - 1) / VERTEX_STREAM_BATCH *
+                 VERTEX_STREAM_BATCH;
+  mClipVertices.resize(count);
+
+  // Transform: the viewport mapping is folded into the matrix, it commutes
+  // with the divide, which then yields pixels directly
+  math::Mat4f viewport =
+      math::screenMatrix<float>(mFrameBuffer->mWidth, mFrameBuffer->mHeight);
+  math::transformBatch(viewport * transform, stream.getX(), stream.getY(),
+                       stream.getZ(), stream.getW(), mClipVertices.getX(),
+                       mClipVertices.getY(), mClipVertices.getZ(),
+                       mClipVertices.getW(), lanes);
+  mClipVertices.perspectiveDivide();
+
+  setupVertices(lanes);
+
+  const float* w = mClipVertices.getW();
+  const int32_t* x = mPixelX.data();
+  const int32_t* y = mPixelY.data();
+  uint32_t index[3];
+  VertexCache::Vertex vertices[3];
+  std::vector<Point> pixels;
+  for (size_t i = 0; i < count; i += 3) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      index[k] = static_cast<uint32_t>(i + k);
+      vertices[k].mX = x[i + k];
+      vertices[k].mY = y[i + k];
+      vertices[k].mW = w[i + k];
+    }
+    renderStreamTriangle(pixels, stream, index, vertices, texUnit);
+  }
+}
+
+void GPU::drawIndexed(const VertexStream& stream,
+                      const std::vector<uint32_t>& indices,
+                      const math::Mat4f& transform, uint32_t texUnit) {
+  drawIndexed(stream, indices.data(), indices.size(), transform, texUnit);
+}
+
+void GPU::drawIndexed(const VertexStream& stream, const uint32_t* indices,
+                      size_t indexCount, const math::Mat4f& transform,
+                      uint32_t texUnit) {
+  mVertexCache.reset();
+
+  math::Mat4f viewport =
+      math::screenMatrix<float>(mFrameBuffer->mWidth, mFrameBuffer->mHeight);
+  math::Mat4f matrix = viewport * transform;
+
+  uint32_t index[3];
+  VertexCache::Vertex vertices[3];
+  std::vector<Point> pixels;
+  for (size_t i = 0; i + 2 < indexCount; i += 3) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      index[k] = indices[i + k];
+      assert(index[k] < stream.size());
+      if (!mVertexCache.lookup(index[k], vertices[k])) {
+        vertices[k] = transformVertex(stream, index[k], matrix);
+        mVertexCache.insert(index[k], vertices[k]);
+      }
+    }
+    renderStreamTriangle(pixels, stream, index, vertices, texUnit);
+  }
+}
+
+VertexCache::Vertex GPU::transformVertex(const VertexStream& stream,
+                                         uint32_t index,
+                                         const math::Mat4f& matrix) const {
+  // Same arithmetic as the batched stages, so that drawIndexed and
+  // drawVertexStream put a vertex on the same pixel
+  float x, y, z, w;
+  math::transformBatch(matrix, stream.getX() + index, stream.getY() + index,
+                       stream.getZ() + index, stream.getW() + index, &x, &y,
+                       &z, &w, 1);
+  if (w > 0.0f) {
+    float inv = 1.0f / w;
+    x *= inv;
+    y *= inv;
+  }
+
+  VertexCache::Vertex vertex;
+  vertex.mX = static_cast<int32_t>(
+      std::lrint(std::clamp(x, -VERTEX_GUARD_BAND, VERTEX_GUARD_BAND)));
+  vertex.mY = static_cast<int32_t>(
+      std::lrint(std::clamp(y, -VERTEX_GUARD_BAND, VERTEX_GUARD_BAND)));
+  vertex.mW = w;
+  return vertex;
+}
+
+void GPU::renderStreamTriangle(std::vector<Point>& pixels,
+                               const VertexStream& stream,
+                               const uint32_t index[3],
+                               const VertexCache::Vertex vertices[3],
+                               uint32_t texUnit) {
+  const VertexCache::Vertex& v0 = vertices[0];
+  const VertexCache::Vertex& v1 = vertices[1];
+  const VertexCache::Vertex& v2 = vertices[2];
+  if (v0.mW <= 0.0f || v1.mW <= 0.0f || v2.mW <= 0.0f) {
+    return;
+  }
+
+  int32_t width = static_cast<int32_t>(mFrameBuffer->mWidth);
+  int32_t height = static_cast<int32_t>(mFrameBuffer->mHeight);
+  if (std::max({v0.mX, v1.mX, v2.mX}) < 0 ||
+      std::min({v0.mX, v1.mX, v2.mX}) >= width ||
+      std::max({v0.mY, v1.mY, v2.mY}) < 0 ||
+      std::min({v0.mY, v1.mY, v2.mY}) >= height) {
+    return;
+  }
+
+  // Points are only built for triangles that are drawn
+  const float* u = stream.getU();
+  const float* v = stream.getV();
+  const RGBA* color = stream.getColor();
+  Point p[3];
+  for (uint32_t k = 0; k < 3; ++k) {
+    p[k].x = vertices[k].mX;
+    p[k].y = vertices[k].mY;
+    if (color) {
+      p[k].color = color[index[k]];
+    }
+    if (u) {
+      p[k].uv = math::vec2f(u[index[k]], v[index[k]]);
     }
+    p[k].texUnit = texUnit;
+  }
+
+  pixels.clear();
+  renderTriangle(pixels, p[0], p[1], p[2]);
+}
 
-    drawPoint(p.x, p.y, resultColor);
+void GPU::setupVertices(size_t lanes) {
+  mPixelX.resize(lanes);
+  mPixelY.resize(lanes);
+
+  // The one float to int conversion of a vertex, rounded to nearest
+  const float* x = mClipVertices.getX();
+  const float* y = mClipVertices.getY();
+  size_t i = 0;
+#ifdef SIMD_SSE2
+  __m128 lo = _mm_set1_ps(-VERTEX_GUARD_BAND);
+  __m128 hi = _mm_set1_ps(VERTEX_GUARD_BAND);
+  for (; i < lanes; i += 4) {
+    __m128 vx = _mm_min_ps(_mm_max_ps(_mm_load_ps(x + i), lo), hi);
+    __m128 vy = _mm_min_ps(_mm_max_ps(_mm_load_ps(y + i), lo), hi);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mPixelX[i]),
+                     _mm_cvtps_epi32(vx));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&mPixelY[i]),
+                     _mm_cvtps_epi32(vy));
+  }
+#endif
+
+  for (; i < lanes; ++i) {
+    mPixelX[i] = static_cast<int32_t>(std::lrint(
+        std::clamp(x[i], -VERTEX_GUARD_BAND, VERTEX_GUARD_BAND)));
+    mPixelY[i] = static_cast<int32_t>(std::lrint(
+        std::clamp(y[i], -VERTEX_GUARD_BAND, VERTEX_GUARD_BAND)));
   }
 }
 
 void GPU::drawImage(const Image* image) {
   for (uint32_t i = 0; i < image->mWidth; ++i) {
     for (uint32_t j = 0; j < image->mHeight; ++j) {
-      drawPoint(i, j, image->mData[j * image->mWidth + i]);
+      drawPoint(i, j, image->getTexel(i, j));
     }
   }
 }
@@ -95,7 +661,7 @@ void GPU::drawImageWidthAlpha(const Image* image, const uint32_t& alpha) {
   RGBA color;
   for (uint32_t i = 0; i < image->mWidth; ++i) {
     for (uint32_t j = 0; j < image->mHeight; ++j) {
-      color = image->mData[j * image->mWidth + i];
+      color = image->getTexel(i, j);
       color.mA = alpha;
       drawPoint(i, j, color);
     }
@@ -104,75 +670,106 @@ void GPU::drawImageWidthAlpha(const Image* image, const uint32_t& alpha) {
 
 void GPU::setBlending(bool enable) { mEnableBlending = enable; }
 
-RGBA GPU::sampleNearest(const math::vec2f& uv) {
-  auto myUV = uv;
+void GPU::setLineSmooth(bool enable) { mLineSmooth = enable; }
 
-  checkWrap(myUV.x);
-  checkWrap(myUV.y);
+void GPU::setRoundPoints(bool enable) { mRoundPoints = enable; }
 
-  int x = std::round(myUV.x * (mImage->mWidth - 1));
-  int y = std::round(myUV.y * (mImage->mHeight - 1));
+void GPU::setLineWidth(float width) { mLineWidth = width; }
 
-  int position = y * mImage->mWidth + x;
-  return mImage->mData[position];
-}
+void GPU::setLineJoin(int32_t join) { mLineJoin = join; }
 
-RGBA GPU::sampleBilinear(const math::vec2f& uv) {
-  RGBA resultColor;
+void GPU::setLineCap(int32_t cap) { mLineCap = cap; }
 
-  auto myUV = uv;
-  checkWrap(myUV.x);
-  checkWrap(myUV.y);
+void GPU::setFrameBufferSRGB(bool enable) { mFrameBuffer->mSRGB = enable; }
 
-  float x = myUV.x * static_cast<float>(mImage->mWidth - 1);
-  float y = myUV.y * static_cast<float>(mImage->mHeight - 1);
+void GPU::setBlendMode(int32_t mode) { mBlendMode = mode; }
 
-  int left = std::floor(x);
-  int right = std::ceil(x);
-  int bottom = std::floor(y);
-  int top = std::ceil(y);
+bool GPU::setHDR(bool enable, float exposure) {
+  if (enable && mFrameBuffer->mSampleBuffer) {
+    return false;
+  }
 
-  float yScale = 0.0f;
-  if (top == bottom) {
-    yScale = 1.0f;
-  } else {
-    yScale =
-        (y - static_cast<float>(bottom)) / static_cast<float>(top - bottom);
+  mFrameBuffer->setHDR(enable);
+  mHDRExposure = exposure;
+  return true;
+}
+
+void GPU::resolveHDR(float exposure) { mFrameBuffer->resolveHDR(exposure); }
+
+void GPU::setVertexCache(uint32_t size, int32_t policy) {
+  mVertexCache.configure(size, policy);
+}
+
+bool GPU::setMultisample(bool enable) {
+  if (enable && mFrameBuffer->mHDRBuffer) {
+    return false;
   }
 
-  int positionLeftTop = top * mImage->mWidth + left;
-  int positionLeftBottom = bottom * mImage->mWidth + left;
-  int positionRightTop = top * mImage->mWidth + right;
-  int positionRightBottom = bottom * mImage->mWidth + right;
+  mFrameBuffer->setMultisample(enable);
+  return true;
+}
 
-  RGBA leftColor = Raster::lerpRGBA(mImage->mData[positionLeftBottom],
-                                    mImage->mData[positionLeftTop], yScale);
-  RGBA rightColor = Raster::lerpRGBA(mImage->mData[positionRightBottom],
-                                     mImage->mData[positionRightTop], yScale);
+void GPU::resolveMultisample() { mFrameBuffer->resolveMultisample(); }
 
-  float xScale = 0.0f;
-  if (right == left) {
-    xScale = 1.0f;
+void GPU::resolveAttachments() {
+  if (!mFrameBuffer || !mFrameBuffer->mResolvePending) {
+    return;
+  }
+
+  if (mFrameBuffer->mSampleBuffer) {
+    mFrameBuffer->resolveMultisample();
   } else {
-    xScale = (x - static_cast<float>(left)) / static_cast<float>(right - left);
+    mFrameBuffer->resolveHDR(mHDRExposure);
   }
+}
 
-  resultColor = Raster::lerpRGBA(leftColor, rightColor, xScale);
-  return resultColor;
+void GPU::setActiveTexture(uint32_t unit) {
+  assert(unit < MAX_TEXTURE_UNITS);
+  mActiveTexture = unit;
 }
 
-void GPU::checkWrap(float& n) {
-  if (n > 1.0f || n < 0.0f) {
-    n = FRACTION(n);
-    switch (mWrapMode) {
-      case TEXTURE_WRAP_REPEAT:
-        n = FRACTION(n + 1);
-        break;
-      case TEXTURE_WRAP_MIRROR:
-        n = 1.0f - FRACTION(n + 1);
-        break;
-      default:
-        break;
-    }
+RGBA GPU::sample(uint32_t unit, const math::vec2f& uv, uint32_t layer,
+                 float lod) const {
+  assert(unit < MAX_TEXTURE_UNITS);
+  const Sampler& sampler = mSamplers[unit];
+  if (!sampler.getImage()) {
+    return RGBA();
   }
+
+  return sampler.sample(uv, lod, layer);
+}
+
+float GPU::computeLOD(const Image* image, const Point& p1, const Point& p2,
+                      const Point& p3) const {
+  // uv is interpolated affinely in screen space, so its derivatives are the
+  // same for every 2x2 quad of the triangle and only need solving once
+  float e1x = static_cast<float>(p2.x - p1.x);
+  float e1y = static_cast<float>(p2.y - p1.y);
+  float e2x = static_cast<float>(p3.x - p1.x);
+  float e2y = static_cast<float>(p3.y - p1.y);
+
+  float det = e1x * e2y - e2x * e1y;
+  if (det == 0.0f) {
+    return 0.0f;
+  }
+  float oneOverDet = 1.0f / det;
+
+  auto duv1 = (p2.uv - p1.uv) * oneOverDet;
+  auto duv2 = (p3.uv - p1.uv) * oneOverDet;
+
+  float width = static_cast<float>(image->mWidth);
+  float height = static_cast<float>(image->mHeight);
+
+  float dudx = (duv1.x * e2y - duv2.x * e1y) * width;
+  float dvdx = (duv1.y * e2y - duv2.y * e1y) * height;
+  float dudy = (duv2.x * e1x - duv1.x * e2x) * width;
+  float dvdy = (duv2.y * e1x - duv1.y * e2x) * height;
+
+  float rhoSquared = std::max(dudx * dudx + dvdx * dvdx,
+                              dudy * dudy + dvdy * dvdy);
+  if (rhoSquared <= 1.0f) {
+    return 0.0f;
+  }
+
+  return 0.5f * std::log2(rhoSquared);
 }
@@ -6,9 +6,20 @@
 #include "../global/base.h"
 #include "Raster.h"
 #include "frameBuffer.h"
+#include "sampler.h"
+#include "stroke.h"
+#include "vertexCache.h"
+#include "vertexStream.h"
 
 #define sgl GPU::getInstance()
 
+#define MAX_TEXTURE_UNITS 8
+
+// drawPoints bins points into square tiles of this many pixels, 16KB of
+// color buffer each
+#define POINT_TILE_SHIFT 6
+#define POINT_TILE_SIZE (1 << POINT_TILE_SHIFT)
+
 class GPU {
  public:
   static GPU* getInstance();
@@ -23,32 +34,215 @@ class GPU {
 
   void drawPoint(const uint32_t& x, const uint32_t& y, const RGBA& color);
 
+  // count points centered at (xs[i], ys[i]), sizes[i] pixels wide, or 1
+  // pixel if sizes is null. Sized points are binned per tile and written a
+  // tile at a time, each pixel still sees them in submission order. Into the
+  // plain color buffer rows are filled and alpha blended four pixels at a
+  // time
+  void drawPoints(const float* xs, const float* ys, const RGBA* colors,
+                  const float* sizes, size_t count);
+
+  // Draw drawPoints points as discs instead of squares
+  void setRoundPoints(bool enable);
+
   void drawLine(const Point& p1, const Point& p2);
 
   void drawTriangle(const Point& p1, const Point& p2, const Point& p3);
 
+  // Every three vertices form a triangle. Each triangle picks its texture
+  // unit and layer from its first vertex, so many materials can be drawn
+  // without rebinding in between
+  void drawTriangles(const std::vector<Point>& vertices);
+
+  // Stroke the polyline through points with the current line width, join
+  // and cap. It is tessellated into triangles and drawn as one drawTriangles
+  // batch, vertices keep the uv and texture unit of their point
+  void drawPolyline(const std::vector<Point>& points);
+
+  // Draw every three vertices of stream as a triangle. Positions go
+  // through transform into clip space and are mapped to the framebuffer,
+  // VERTEX_STREAM_BATCH vertices at a time. Triangles are textured from
+  // texUnit. There is no clipping: triangles with a vertex behind the eye
+  // are dropped
+  void drawVertexStream(const VertexStream& stream,
+                        const math::Mat4f& transform, uint32_t texUnit = 0);
+
+  // drawVertexStream with every three indices forming a triangle. Vertices
+  // go through the post-transform cache, a vertex still cached from an
+  // earlier triangle is not transformed again. VertexCache::optimize orders
+  // indices for it
+  void drawIndexed(const VertexStream& stream,
+                   const std::vector<uint32_t>& indices,
+                   const math::Mat4f& transform, uint32_t texUnit = 0);
+  void drawIndexed(const VertexStream& stream, const uint32_t* indices,
+                   size_t indexCount, const math::Mat4f& transform,
+                   uint32_t texUnit = 0);
+
+  // Post-transform cache of drawIndexed: size entries (0 disables it) and a
+  // VERTEX_CACHE_* replacement policy
+  void setVertexCache(uint32_t size, int32_t policy = VERTEX_CACHE_LRU);
+
+  // Hits and misses of the last drawIndexed
+  VertexCache::Stats getVertexCacheStats() const {
+    return mVertexCache.getStats();
+  }
+
   void drawImage(const Image* image);
 
   void drawImageWidthAlpha(const Image* image, const uint32_t& alpha);
 
   void setBlending(bool enable);
 
-  void setTexture(Image* image) { mImage = image; }
-  void setBilinear(bool enable) { mEnableBilinear = enable; }
-
-  void setWrapMode(int32_t mode) { mWrapMode = mode; }
+  // Draw lines anti-aliased. Their coverage is blended in by alpha whether
+  // blending is enabled or not
+  void setLineSmooth(bool enable);
+
+  // Stroke state of drawPolyline, width in pixels. LINE_JOIN_MITER falls
+  // back to bevel past STROKE_MITER_LIMIT
+  void setLineWidth(float width);
+  void setLineJoin(int32_t join);
+  void setLineCap(int32_t cap);
+
+  // Treat the color buffer as sRGB encoded, blending then happens in linear
+  // light through lookup tables
+  void setFrameBufferSRGB(bool enable);
+
+  // BLEND_MODE_ALPHA: src over dst by src alpha. BLEND_MODE_ADDITIVE: dst
+  // plus src scaled by src alpha, saturating unless rendering to HDR
+  void setBlendMode(int32_t mode);
+
+  // Render into a float attachment instead of the 8-bit color buffer, so
+  // that additive passes can accumulate past 1.0. It is tone-mapped with
+  // exposure into the color buffer by resolveAttachments before the frame is
+  // presented. resolveHDR does it earlier, e.g. to read the result back.
+  // Cannot be combined with multisampling, enabling it while that is on
+  // fails and returns false
+  bool setHDR(bool enable, float exposure = 1.0f);
+  void resolveHDR(float exposure = 1.0f);
+
+  // 4x MSAA: triangles are rasterized with per-sample coverage into a
+  // multisampled attachment but shaded once per pixel, everything else
+  // covers all samples. The samples are averaged into the color buffer by
+  // resolveAttachments or resolveMultisample. Cannot be combined with HDR,
+  // enabling it while that is on fails and returns false
+  bool setMultisample(bool enable);
+  void resolveMultisample();
+
+  // Resolve the multisampled or HDR attachment into the color buffer if it
+  // was drawn to since its last resolve. Call it every frame before
+  // Application::show presents the canvas
+  void resolveAttachments();
+
+  // Texture state calls below apply to the active unit
+  void setActiveTexture(uint32_t unit);
+
+  // Sampling functions are resolved here, not per fragment
+  void setTexture(Image* image) { mSamplers[mActiveTexture].setImage(image); }
+  void setBilinear(bool enable) {
+    mSamplers[mActiveTexture].setFilter(enable ? TEXTURE_FILTER_LINEAR
+                                               : TEXTURE_FILTER_NEAREST);
+  }
+
+  void setWrapMode(int32_t mode) {
+    mSamplers[mActiveTexture].setWrapMode(mode, mode);
+  }
+  void setWrapMode(int32_t wrapS, int32_t wrapT) {
+    mSamplers[mActiveTexture].setWrapMode(wrapS, wrapT);
+  }
+
+  void setMipmapMode(int32_t mode) {
+    mSamplers[mActiveTexture].setMipmapMode(mode);
+  }
+
+  // Route uncompressed texel reads through the texel cache, whose hit/miss
+  // counters (TexelCache::getStats) then show the access locality
+  void setTexelCache(bool enable) {
+    mSamplers[mActiveTexture].setCached(enable);
+  }
+
+  // Sample any bound unit, e.g. to combine several textures per fragment
+  RGBA sample(uint32_t unit, const math::vec2f& uv, uint32_t layer = 0,
+              float lod = 0.0f) const;
 
  private:
-  RGBA sampleNearest(const math::vec2f& uv);
-  RGBA sampleBilinear(const math::vec2f& uv);
-
-  void checkWrap(float& n);
+  // Source blended over dst in the current blend mode
+  RGBA blend(const RGBA& src, const RGBA& dst) const;
+
+  // drawPoint into the float attachment
+  void drawPointHDR(float* dst, const RGBA& color);
+
+  // drawPoint into the covered samples of the multisampled attachment
+  void drawPointSamples(uint32_t pixelPos, const RGBA& color,
+                        uint8_t coverage);
+
+  // One row of a drawPoints point, x0..x1 inclusive. direct writes the
+  // color buffer without going through drawPoint
+  void drawPointSpan(int32_t y, int32_t x0, int32_t x1, const RGBA& color,
+                     bool direct);
+
+  // drawPoint of a rasterized fragment, honoring its coverage
+  void drawFragment(const Point& p, const RGBA& color);
+
+  // Setup stage of drawVertexStream: round the first lanes projected
+  // positions of mClipVertices to pixels in mPixelX/mPixelY
+  void setupVertices(size_t lanes);
+
+  // Vertex stage of drawIndexed for one vertex, matrix includes the viewport
+  VertexCache::Vertex transformVertex(const VertexStream& stream,
+                                      uint32_t index,
+                                      const math::Mat4f& matrix) const;
+
+  // Primitive assembly of the stream draws: triangles with a vertex behind
+  // the eye or entirely off screen are dropped, the rest is rasterized.
+  // vertices[k] is the transformed stream vertex index[k]
+  void renderStreamTriangle(std::vector<Point>& pixels,
+                            const VertexStream& stream,
+                            const uint32_t index[3],
+                            const VertexCache::Vertex vertices[3],
+                            uint32_t texUnit);
+
+  void renderTriangle(std::vector<Point>& pixels, const Point& p1,
+                      const Point& p2, const Point& p3);
+
+  // Level of detail of a triangle's texture footprint, log2 of texels per
+  // pixel along the longer screen axis
+  float computeLOD(const Image* image, const Point& p1, const Point& p2,
+                   const Point& p3) const;
 
   static std::unique_ptr<GPU> mInstance;
   bool mEnableBlending{false};
-  bool mEnableBilinear{false};
+  bool mLineSmooth{false};
+  bool mRoundPoints{false};
+  float mLineWidth{1.0f};
+  int32_t mLineJoin{LINE_JOIN_MITER};
+  int32_t mLineCap{LINE_CAP_BUTT};
+
+  // Reused by drawPolyline, so that strokes do not allocate once warm
+  std::vector<Point> mStrokeVertices;
+
+  // drawVertexStream stages: transformed positions and their pixels. Kept
+  // between calls
+  VertexStream mClipVertices{VERTEX_FORMAT_POSITION};
+  std::vector<int32_t> mPixelX;
+  std::vector<int32_t> mPixelY;
+
+  VertexCache mVertexCache;
+
+  // Pixel bounds of a drawPoints point, mX1 < 0 when it is off screen
+  struct PointRect {
+    int32_t mX0, mY0, mX1, mY1;
+  };
+
+  // drawPoints bins: point indices grouped by tile, and where each tile's
+  // group starts. Kept between calls
+  std::vector<PointRect> mPointRects;
+  std::vector<uint32_t> mPointBins;
+  std::vector<uint32_t> mPointBinStart;
+  std::vector<uint32_t> mPointBinCursor;
+  int32_t mBlendMode{BLEND_MODE_ALPHA};
+  float mHDRExposure{1.0f};
 
-  int32_t mWrapMode{TEXTURE_WRAP_REPEAT};
   FrameBuffer* mFrameBuffer{nullptr};
-  Image* mImage{nullptr};
+  uint32_t mActiveTexture{0};
+  Sampler mSamplers[MAX_TEXTURE_UNITS];
 };
\ No newline at end of file
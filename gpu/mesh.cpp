@@ -0,0 +1,647 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "../application/textureCache.h"
+#include "../application/threadPool.h"
+#include "vertexCache.h"
+
+// Corner without a texture coordinate
+#define MESH_NO_UV 0xffffffffu
+
+static uint64_t alignOffset(uint64_t offset) {
+  return (offset + MESH_CACHE_ALIGNMENT - 1) &
+         ~static_cast<uint64_t>(MESH_CACHE_ALIGNMENT - 1);
+}
+
+// Tokenizer over one line of the mapped text: it never reads past mEnd, so
+// the text needs no terminator, and never allocates
+struct ObjCursor {
+  const char* mPos;
+  const char* mEnd;
+};
+
+static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+static void skipBlanks(ObjCursor& c) {
+  while (c.mPos < c.mEnd && isBlank(*c.mPos)) {
+    ++c.mPos;
+  }
+}
+
+// Skip the keyword at the start of a line if it matches, it must be
+// followed by a blank
+static bool matchKeyword(ObjCursor& c, const char* keyword, size_t length) {
+  if (static_cast<size_t>(c.mEnd - c.mPos) <= length ||
+      memcmp(c.mPos, keyword, length) != 0 || !isBlank(c.mPos[length])) {
+    return false;
+  }
+  c.mPos += length;
+  return true;
+}
+
+static bool parseInt(ObjCursor& c, int64_t& value) {
+  const char* p = c.mPos;
+  bool negative = p < c.mEnd && *p == '-';
+  if (p < c.mEnd && (*p == '-' || *p == '+')) {
+    ++p;
+  }
+  if (p == c.mEnd || !isDigit(*p)) {
+    return false;
+  }
+
+  int64_t result = 0;
+  for (; p < c.mEnd && isDigit(*p); ++p) {
+    if (result < (int64_t(1) << 40)) {
+      result = result * 10 + (*p - '0');
+    }
+  }
+
+  value = negative ? -result : result;
+  c.mPos = p;
+  return true;
+}
+
+// Decimal with optional fraction and exponent. The digits are gathered in
+// an integer and scaled once, exact to float precision
+static bool parseFloat(ObjCursor& c, float& value) {
+  static const double sPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                  1e18, 1e19, 1e20, 1e21, 1e22};
+
+  skipBlanks(c);
+  const char* p = c.mPos;
+  bool negative = p < c.mEnd && *p == '-';
+  if (p < c.mEnd && (*p == '-' || *p == '+')) {
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int32_t exponent = 0;
+  int32_t digits = 0;
+  for (; p < c.mEnd && isDigit(*p); ++p, ++digits) {
+    if (mantissa < 100000000000000000ull) {
+      mantissa = mantissa * 10 + (*p - '0');
+    } else {
+      ++exponent;
+    }
+  }
+  if (p < c.mEnd && *p == '.') {
+    for (++p; p < c.mEnd && isDigit(*p); ++p, ++digits) {
+      if (mantissa < 100000000000000000ull) {
+        mantissa = mantissa * 10 + (*p - '0');
+        --exponent;
+      }
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+
+  if (p + 1 < c.mEnd && (*p == 'e' || *p == 'E')) {
+    ObjCursor e{p + 1, c.mEnd};
+    int64_t power = 0;
+    if (parseInt(e, power)) {
+      exponent += static_cast<int32_t>(std::clamp<int64_t>(power, -400, 400));
+      p = e.mPos;
+    }
+  }
+
+  double result = static_cast<double>(mantissa);
+  if (mantissa != 0 && exponent != 0) {
+    int32_t magnitude = std::abs(exponent);
+    double scale = magnitude <= 22 ? sPow10[magnitude]
+                                   : std::pow(10.0, magnitude);
+    result = exponent > 0 ? result * scale : result / scale;
+  }
+
+  value = static_cast<float>(negative ? -result : result);
+  c.mPos = p;
+  return true;
+}
+
+// One face corner: "v", "v/vt", "v//vn" or "v/vt/vn", normals are skipped
+static bool parseCorner(ObjCursor& c, int64_t& position, int64_t& uv) {
+  uv = 0;
+  if (!parseInt(c, position)) {
+    return false;
+  }
+  if (c.mPos < c.mEnd && *c.mPos == '/') {
+    ++c.mPos;
+    if (c.mPos < c.mEnd && *c.mPos != '/' && !parseInt(c, uv)) {
+      return false;
+    }
+    if (c.mPos < c.mEnd && *c.mPos == '/') {
+      ++c.mPos;
+      int64_t normal = 0;
+      parseInt(c, normal);
+    }
+  }
+  return c.mPos == c.mEnd || isBlank(*c.mPos);
+}
+
+// OBJ indices count from 1, negative ones back from the last element
+// defined so far. Result is MESH_NO_UV if out of range
+static uint32_t resolveIndex(int64_t index, size_t definedSoFar,
+                             size_t total) {
+  int64_t resolved =
+      index > 0 ? index - 1 : static_cast<int64_t>(definedSoFar) + index;
+  if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(total)) {
+    return MESH_NO_UV;
+  }
+  return static_cast<uint32_t>(resolved);
+}
+
+// A run of whole lines, parsed by one thread. The first pass counts what
+// the chunk defines, the prefix sums of the counts tell the second pass
+// where in the shared arrays to write, so no thread allocates or locks
+struct ObjChunk {
+  const char* mBegin{nullptr};
+  const char* mEnd{nullptr};
+
+  size_t mPositions{0};
+  size_t mUvs{0};
+  size_t mTriangles{0};
+
+  size_t mPositionBase{0};
+  size_t mUvBase{0};
+  size_t mTriangleBase{0};
+
+  bool mValid{true};
+};
+
+// Arrays filled by the second pass
+struct ObjData {
+  std::vector<float> mX, mY, mZ, mW;
+  std::vector<float> mU, mV;
+
+  // Three corners per triangle, resolved to 0-based indices
+  std::vector<uint32_t> mCornerPosition;
+  std::vector<uint32_t> mCornerUv;
+};
+
+template <typename F>
+static void forEachLine(const char* begin, const char* end, F&& f) {
+  const char* line = begin;
+  while (line < end) {
+    const void* newline = memchr(line, '\n', end - line);
+    const char* lineEnd = newline ? static_cast<const char*>(newline) : end;
+    ObjCursor c{line, lineEnd};
+    skipBlanks(c);
+    f(c);
+    line = lineEnd + 1;
+  }
+}
+
+static void countChunk(ObjChunk& chunk) {
+  forEachLine(chunk.mBegin, chunk.mEnd, [&](ObjCursor& c) {
+    if (matchKeyword(c, "v", 1)) {
+      ++chunk.mPositions;
+    } else if (matchKeyword(c, "vt", 2)) {
+      ++chunk.mUvs;
+    } else if (matchKeyword(c, "f", 1)) {
+      size_t corners = 0;
+      for (skipBlanks(c); c.mPos < c.mEnd; skipBlanks(c)) {
+        while (c.mPos < c.mEnd && !isBlank(*c.mPos)) {
+          ++c.mPos;
+        }
+        ++corners;
+      }
+      chunk.mTriangles += corners > 2 ? corners - 2 : 0;
+    }
+  });
+}
+
+static void parseChunk(ObjChunk& chunk, ObjData& data, size_t positionCount,
+                       size_t uvCount) {
+  size_t position = chunk.mPositionBase;
+  size_t uv = chunk.mUvBase;
+  size_t corner = chunk.mTriangleBase * 3;
+  size_t cornerEnd = corner + chunk.mTriangles * 3;
+
+  forEachLine(chunk.mBegin, chunk.mEnd, [&](ObjCursor& c) {
+    if (!chunk.mValid) {
+      return;
+    }
+
+    if (matchKeyword(c, "v", 1)) {
+      float w = 1.0f;
+      if (!parseFloat(c, data.mX[position]) ||
+          !parseFloat(c, data.mY[position]) ||
+          !parseFloat(c, data.mZ[position])) {
+        chunk.mValid = false;
+        return;
+      }
+      // A fourth number is w only if it is the last one, exporters write
+      // vertex colors as "v x y z r g b"
+      float extra = 0.0f;
+      if (parseFloat(c, w) && parseFloat(c, extra)) {
+        w = 1.0f;
+      }
+      data.mW[position++] = w;
+    } else if (matchKeyword(c, "vt", 2)) {
+      float v = 0.0f;
+      if (!parseFloat(c, data.mU[uv])) {
+        chunk.mValid = false;
+        return;
+      }
+      parseFloat(c, v);
+      data.mV[uv++] = v;
+    } else if (matchKeyword(c, "f", 1)) {
+      // Fanned around the first corner
+      uint32_t first[2] = {0, 0};
+      uint32_t previous[2] = {0, 0};
+      for (size_t k = 0; skipBlanks(c), c.mPos < c.mEnd; ++k) {
+        int64_t p = 0, t = 0;
+        if (!parseCorner(c, p, t)) {
+          chunk.mValid = false;
+          return;
+        }
+
+        uint32_t current[2];
+        current[0] = resolveIndex(p, position, positionCount);
+        current[1] = t ? resolveIndex(t, uv, uvCount) : MESH_NO_UV;
+        if (current[0] == MESH_NO_UV || (t && current[1] == MESH_NO_UV)) {
+          chunk.mValid = false;
+          return;
+        }
+
+        if (k >= 2 && corner + 3 <= cornerEnd) {
+          const uint32_t* triangle[3] = {first, previous, current};
+          for (auto vertex : triangle) {
+            data.mCornerPosition[corner] = vertex[0];
+            data.mCornerUv[corner++] = vertex[1];
+          }
+        }
+        uint32_t* keep = k == 0 ? first : previous;
+        keep[0] = current[0];
+        keep[1] = current[1];
+        if (k == 0) {
+          previous[0] = current[0];
+          previous[1] = current[1];
+        }
+      }
+    }
+  });
+}
+
+// Run task on every chunk, on the parser threads if there are several
+template <typename F>
+static void runChunks(std::vector<ObjChunk>& chunks, F&& task) {
+  size_t count = chunks.size();
+  if (count == 1) {
+    task(chunks[0]);
+    return;
+  }
+
+  // Chunks are claimed by index and the caller claims them too, so the
+  // parse finishes even when every pool thread is busy, e.g. when a mesh is
+  // loaded from a pool task. Helpers starting late find nothing left and
+  // only touch the shared progress
+  struct Progress {
+    std::atomic<size_t> mNext{0};
+    std::atomic<size_t> mDone{0};
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+  };
+  auto progress = std::make_shared<Progress>();
+  auto work = [progress, count, &chunks, &task]() {
+    for (size_t i; (i = progress->mNext++) < count;) {
+      task(chunks[i]);
+      if (++progress->mDone == count) {
+        std::lock_guard<std::mutex> lock(progress->mMutex);
+        progress->mCondition.notify_one();
+      }
+    }
+  };
+
+  for (size_t i = 1; i < count; ++i) {
+    ThreadPool::getShared()->submit(work);
+  }
+  work();
+
+  std::unique_lock<std::mutex> lock(progress->mMutex);
+  progress->mCondition.wait(lock,
+                            [&]() { return progress->mDone == count; });
+}
+
+Mesh::Mesh() {}
+
+Mesh::~Mesh() {}
+
+Mesh* Mesh::createMesh(const std::string& path) {
+  MappedFile file;
+  if (!file.open(path)) {
+    return nullptr;
+  }
+
+  return createMeshFromMemory(reinterpret_cast<const char*>(file.getData()),
+                              file.getSize());
+}
+
+Mesh* Mesh::createMeshFromMemory(const char* text, size_t size) {
+  // Chunks end after a newline, so that no line is split
+  size_t chunkCount = std::min<size_t>(
+      ThreadPool::getShared()->getThreadCount(),
+      std::max<size_t>(size / MESH_PARSE_MIN_CHUNK, 1));
+  std::vector<ObjChunk> chunks(chunkCount);
+  const char* end = text + size;
+  const char* begin = text;
+  for (size_t i = 0; i < chunkCount; ++i) {
+    const char* chunkEnd = i + 1 == chunkCount ? end : text + size * (i + 1) /
+                                                               chunkCount;
+    if (chunkEnd < begin) {
+      chunkEnd = begin;
+    }
+    const void* newline = memchr(chunkEnd, '\n', end - chunkEnd);
+    chunkEnd = newline ? static_cast<const char*>(newline) + 1 : end;
+
+    chunks[i].mBegin = begin;
+    chunks[i].mEnd = chunkEnd;
+    begin = chunkEnd;
+  }
+
+  runChunks(chunks, countChunk);
+
+  size_t positionCount = 0, uvCount = 0, triangleCount = 0;
+  for (auto& chunk : chunks) {
+    chunk.mPositionBase = positionCount;
+    chunk.mUvBase = uvCount;
+    chunk.mTriangleBase = triangleCount;
+    positionCount += chunk.mPositions;
+    uvCount += chunk.mUvs;
+    triangleCount += chunk.mTriangles;
+  }
+  if (triangleCount == 0) {
+    return nullptr;
+  }
+
+  ObjData data;
+  for (auto array : {&data.mX, &data.mY, &data.mZ, &data.mW}) {
+    array->resize(positionCount);
+  }
+  data.mU.resize(uvCount);
+  data.mV.resize(uvCount);
+  data.mCornerPosition.resize(triangleCount * 3);
+  data.mCornerUv.resize(triangleCount * 3);
+
+  runChunks(chunks, [&](ObjChunk& chunk) {
+    parseChunk(chunk, data, positionCount, uvCount);
+  });
+  for (auto& chunk : chunks) {
+    if (!chunk.mValid) {
+      return nullptr;
+    }
+  }
+
+  // Weld corners sharing position and uv, open addressing on the pair
+  size_t corners = triangleCount * 3;
+  size_t tableSize = 1;
+  while (tableSize < corners * 2) {
+    tableSize <<= 1;
+  }
+  std::vector<uint64_t> keys(tableSize, ~0ull);
+  std::vector<uint32_t> values(tableSize);
+  std::vector<uint32_t> sourcePosition;
+  std::vector<uint32_t> sourceUv;
+
+  Mesh* mesh = new Mesh();
+  mesh->mIndexStorage.resize(corners);
+  for (size_t i = 0; i < corners; ++i) {
+    uint64_t key = static_cast<uint64_t>(data.mCornerPosition[i]) << 32 |
+                   data.mCornerUv[i];
+    size_t slot = (key * 0x9e3779b97f4a7c15ull) >> 32 & (tableSize - 1);
+    while (keys[slot] != ~0ull && keys[slot] != key) {
+      slot = (slot + 1) & (tableSize - 1);
+    }
+    if (keys[slot] != key) {
+      keys[slot] = key;
+      values[slot] = static_cast<uint32_t>(sourcePosition.size());
+      sourcePosition.push_back(data.mCornerPosition[i]);
+      sourceUv.push_back(data.mCornerUv[i]);
+    }
+    mesh->mIndexStorage[i] = values[slot];
+  }
+
+  size_t vertexCount = sourcePosition.size();
+  mesh->mVertices.setFormat(VERTEX_FORMAT_POSITION |
+                            (uvCount ? VERTEX_ATTRIB_UV : 0));
+  mesh->mVertices.resize(vertexCount);
+  float* x = mesh->mVertices.getX();
+  float* y = mesh->mVertices.getY();
+  float* z = mesh->mVertices.getZ();
+  float* w = mesh->mVertices.getW();
+  float* u = mesh->mVertices.getU();
+  float* v = mesh->mVertices.getV();
+  for (size_t i = 0; i < vertexCount; ++i) {
+    uint32_t p = sourcePosition[i];
+    x[i] = data.mX[p];
+    y[i] = data.mY[p];
+    z[i] = data.mZ[p];
+    w[i] = data.mW[p];
+    if (u && sourceUv[i] != MESH_NO_UV) {
+      u[i] = data.mU[sourceUv[i]];
+      v[i] = data.mV[sourceUv[i]];
+    }
+  }
+
+  VertexCache::optimize(mesh->mIndexStorage, vertexCount);
+  mesh->mIndices = mesh->mIndexStorage.data();
+  mesh->mIndexCount = corners;
+  mesh->mBounds = mesh->mVertices.computeBounds();
+
+  return mesh;
+}
+
+void Mesh::destroyMesh(Mesh* mesh) {
+  if (mesh) {
+    delete mesh;
+  }
+}
+
+Mesh* Mesh::loadMesh(const std::string& path,
+                     const std::string& cacheDirectory) {
+  MappedFile source;
+  if (!source.open(path)) {
+    return nullptr;
+  }
+
+  uint64_t hash = TextureCache::hashData(source.getData(), source.getSize());
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.smsh",
+           static_cast<unsigned long long>(hash));
+  std::string cachePath =
+      (std::filesystem::path(cacheDirectory) / name).string();
+
+  Mesh* mesh = mapMesh(cachePath, hash);
+  if (mesh) {
+    return mesh;
+  }
+
+  mesh = createMeshFromMemory(reinterpret_cast<const char*>(source.getData()),
+                              source.getSize());
+  if (!mesh) {
+    return nullptr;
+  }
+
+  // Written under a temporary name so readers never see a partial file
+  std::error_code error;
+  std::filesystem::create_directories(cacheDirectory, error);
+  std::string tempPath = cachePath + ".tmp";
+  if (writeMesh(mesh, tempPath, hash)) {
+    std::filesystem::rename(tempPath, cachePath, error);
+  }
+
+  return mesh;
+}
+
+bool Mesh::writeMesh(const Mesh* mesh, const std::string& path,
+                     uint64_t sourceHash) {
+  if (!mesh || !mesh->mIndices) {
+    return false;
+  }
+
+  const VertexStream& vertices = mesh->mVertices;
+  size_t lanes = (vertices.size() + VERTEX_STREAM_BATCH - 1) /
+                 VERTEX_STREAM_BATCH * VERTEX_STREAM_BATCH;
+
+  MeshCacheHeader header;
+  header.mFormat = vertices.getFormat();
+  header.mVertexCount = vertices.size();
+  header.mIndexCount = mesh->mIndexCount;
+  header.mSourceHash = sourceHash;
+  for (int i = 0; i < 3; ++i) {
+    header.mBoundsMin[i] = mesh->mBounds.min[i];
+    header.mBoundsMax[i] = mesh->mBounds.max[i];
+  }
+
+  const void* arrays[MESH_ARRAY_COUNT] = {
+      vertices.getX(), vertices.getY(), vertices.getZ(),     vertices.getW(),
+      vertices.getU(), vertices.getV(), vertices.getColor(), mesh->mIndices};
+  size_t bytes[MESH_ARRAY_COUNT];
+  uint64_t offset = alignOffset(sizeof(MeshCacheHeader));
+  for (int i = 0; i < MESH_ARRAY_COUNT; ++i) {
+    bytes[i] = i == MESH_ARRAY_INDICES ? mesh->mIndexCount * sizeof(uint32_t)
+                                       : lanes * sizeof(float);
+    if (arrays[i]) {
+      header.mOffsets[i] = offset;
+      offset = alignOffset(offset + bytes[i]);
+    }
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (int i = 0; ok && i < MESH_ARRAY_COUNT; ++i) {
+    if (!arrays[i]) {
+      continue;
+    }
+    ok = TextureCache::seekFile(file, header.mOffsets[i]) &&
+         fwrite(arrays[i], 1, bytes[i], file) == bytes[i];
+  }
+
+  ok = (fclose(file) == 0) && ok;
+  if (!ok) {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+
+  return ok;
+}
+
+Mesh* Mesh::mapMesh(const std::string& path, uint64_t expectedHash) {
+  Mesh* mesh = new Mesh();
+  MappedFile& file = mesh->mFile;
+  if (!file.open(path) || file.getSize() < sizeof(MeshCacheHeader)) {
+    delete mesh;
+    return nullptr;
+  }
+
+  const byte* data = file.getData();
+  size_t size = file.getSize();
+  const auto* header = reinterpret_cast<const MeshCacheHeader*>(data);
+  if (header->mMagic != MESH_CACHE_MAGIC ||
+      header->mVersion != MESH_CACHE_VERSION ||
+      (expectedHash && header->mSourceHash != expectedHash)) {
+    delete mesh;
+    return nullptr;
+  }
+
+  // Counts bounded by the file size first, so the sizes below cannot
+  // overflow
+  if (header->mVertexCount > size / (4 * sizeof(float)) ||
+      header->mVertexCount > 0xffffffffull ||
+      header->mIndexCount > size / sizeof(uint32_t) ||
+      header->mIndexCount % 3 != 0) {
+    delete mesh;
+    return nullptr;
+  }
+
+  bool uv = (header->mFormat & VERTEX_ATTRIB_UV) != 0;
+  bool color = (header->mFormat & VERTEX_ATTRIB_COLOR) != 0;
+  uint64_t lanes = (header->mVertexCount + VERTEX_STREAM_BATCH - 1) /
+                   VERTEX_STREAM_BATCH * VERTEX_STREAM_BATCH;
+  bool needed[MESH_ARRAY_COUNT] = {true, true, true, true,
+                                   uv,   uv,   color, true};
+  const byte* arrays[MESH_ARRAY_COUNT] = {};
+  for (int i = 0; i < MESH_ARRAY_COUNT; ++i) {
+    if (!needed[i]) {
+      continue;
+    }
+    uint64_t offset = header->mOffsets[i];
+    uint64_t bytes = i == MESH_ARRAY_INDICES
+                         ? header->mIndexCount * sizeof(uint32_t)
+                         : lanes * sizeof(float);
+    if (offset == 0 || offset % MESH_CACHE_ALIGNMENT != 0 || offset > size ||
+        bytes > size - offset) {
+      delete mesh;
+      return nullptr;
+    }
+    arrays[i] = data + offset;
+  }
+
+  // drawIndexed only asserts the index range, a stale or corrupt file must
+  // not reach it
+  const auto* indices =
+      reinterpret_cast<const uint32_t*>(arrays[MESH_ARRAY_INDICES]);
+  uint32_t maxIndex = 0;
+  for (uint64_t i = 0; i < header->mIndexCount; ++i) {
+    maxIndex = std::max(maxIndex, indices[i]);
+  }
+  if (header->mIndexCount && maxIndex >= header->mVertexCount) {
+    delete mesh;
+    return nullptr;
+  }
+
+  auto floats = [&](int i) {
+    return reinterpret_cast<const float*>(arrays[i]);
+  };
+  mesh->mVertices.attach(
+      header->mFormat, header->mVertexCount, floats(MESH_ARRAY_X),
+      floats(MESH_ARRAY_Y), floats(MESH_ARRAY_Z), floats(MESH_ARRAY_W),
+      floats(MESH_ARRAY_U), floats(MESH_ARRAY_V),
+      reinterpret_cast<const RGBA*>(arrays[MESH_ARRAY_COLOR]));
+  mesh->mIndices = indices;
+  mesh->mIndexCount = header->mIndexCount;
+  mesh->mBounds = math::AABB<float>(
+      math::vec3f(header->mBoundsMin[0], header->mBoundsMin[1],
+                  header->mBoundsMin[2]),
+      math::vec3f(header->mBoundsMax[0], header->mBoundsMax[1],
+                  header->mBoundsMax[2]));
+
+  return mesh;
+}
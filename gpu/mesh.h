@@ -0,0 +1,89 @@
+#pragma once
+#include "../application/mappedFile.h"
+#include "../global/base.h"
+#include "vertexStream.h"
+
+// "SMSH" in file byte order
+#define MESH_CACHE_MAGIC 0x48534d53
+#define MESH_CACHE_VERSION 1
+
+// Every array of a cached mesh starts on this boundary, enough for the
+// aligned loads of the vertex stages once mapped
+#define MESH_CACHE_ALIGNMENT 64
+
+// Vertex arrays of a cached mesh, in MeshCacheHeader::mOffsets
+#define MESH_ARRAY_X 0
+#define MESH_ARRAY_Y 1
+#define MESH_ARRAY_Z 2
+#define MESH_ARRAY_W 3
+#define MESH_ARRAY_U 4
+#define MESH_ARRAY_V 5
+#define MESH_ARRAY_COLOR 6
+#define MESH_ARRAY_INDICES 7
+#define MESH_ARRAY_COUNT 8
+
+// OBJ files smaller than this are parsed on the calling thread alone
+#define MESH_PARSE_MIN_CHUNK (256 * 1024)
+
+// Cached mesh container, native byte order: header, then each array at its
+// aligned offset. Vertex arrays are VertexStream arrays, padded to whole
+// batches; offsets of arrays missing from the format are 0
+struct MeshCacheHeader {
+  uint32_t mMagic{MESH_CACHE_MAGIC};
+  uint32_t mVersion{MESH_CACHE_VERSION};
+  uint32_t mFormat{VERTEX_FORMAT_POSITION};
+  uint32_t mReserved{0};
+  uint64_t mVertexCount{0};
+  uint64_t mIndexCount{0};
+  uint64_t mSourceHash{0};
+  float mBoundsMin[3]{0.0f, 0.0f, 0.0f};
+  float mBoundsMax[3]{0.0f, 0.0f, 0.0f};
+  uint64_t mOffsets[MESH_ARRAY_COUNT]{};
+};
+
+// Indexed triangle mesh in the pipeline's layout: a VertexStream for the
+// vertex stages and triangle indices for GPU::drawIndexed, ordered for the
+// post-transform cache
+class Mesh {
+ public:
+  Mesh();
+  ~Mesh();
+  Mesh(const Mesh&) = delete;
+
+  // Parse a Wavefront OBJ file: v (x y z [w], or x y z followed by vertex
+  // colors, which are ignored), vt and f lines, everything else is skipped.
+  // Faces are fanned into triangles, corners with the same position and uv
+  // are welded into one vertex. The mapped file is split at line boundaries
+  // and parsed on the loader threads
+  static Mesh* createMesh(const std::string& path);
+  static Mesh* createMeshFromMemory(const char* data, size_t size);
+  static void destroyMesh(Mesh* mesh);
+
+  // Map the cached copy of path from cacheDirectory, keyed by a hash of the
+  // OBJ content. Parses and writes the cache first if there is none
+  static Mesh* loadMesh(const std::string& path,
+                        const std::string& cacheDirectory);
+
+  // Write mesh into a container file
+  static bool writeMesh(const Mesh* mesh, const std::string& path,
+                        uint64_t sourceHash = 0);
+
+  // Mesh whose arrays point into the mapped file, nothing is parsed or
+  // copied. expectedHash of 0 accepts any source
+  static Mesh* mapMesh(const std::string& path, uint64_t expectedHash = 0);
+
+  const uint32_t* getIndices() const { return mIndices; }
+  size_t getIndexCount() const { return mIndexCount; }
+
+ public:
+  VertexStream mVertices;
+  math::AABB<float> mBounds;
+
+ private:
+  // Parsed meshes own their indices, mapped ones point into mFile
+  std::vector<uint32_t> mIndexStorage;
+  MappedFile mFile;
+
+  const uint32_t* mIndices{nullptr};
+  size_t mIndexCount{0};
+};
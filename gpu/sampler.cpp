@@ -0,0 +1,384 @@
+#include "sampler.h"
+
+#include "../application/srgb.h"
+#include "Raster.h"
+#include "texelCache.h"
+
+// Remove an even integer part so that repeat (period 1) and mirror (period 2)
+// addressing is unchanged while texel coordinates stay well inside int32
+template <int32_t WRAP>
+static inline float reduceCoord(float u) {
+  if constexpr (WRAP == TEXTURE_WRAP_CLAMP_TO_EDGE) {
+    return std::min(std::max(u, -1.0f), 2.0f);
+  } else {
+    return u - static_cast<float>(static_cast<int32_t>(u) & ~1);
+  }
+}
+
+static inline int32_t floorToInt(float v) {
+  auto i = static_cast<int32_t>(v);
+  return i - (v < static_cast<float>(i));
+}
+
+template <int32_t WRAP, bool POW2>
+static inline uint32_t wrapTexel(int32_t x, uint32_t size) {
+  if constexpr (WRAP == TEXTURE_WRAP_CLAMP_TO_EDGE) {
+    return static_cast<uint32_t>(
+        std::min(std::max(x, 0), static_cast<int32_t>(size) - 1));
+  } else if constexpr (WRAP == TEXTURE_WRAP_MIRROR) {
+    uint32_t period = size * 2;
+    uint32_t m = 0;
+    if constexpr (POW2) {
+      m = static_cast<uint32_t>(x) & (period - 1);
+    } else {
+      int32_t r = x % static_cast<int32_t>(period);
+      m = static_cast<uint32_t>(r < 0 ? r + static_cast<int32_t>(period) : r);
+    }
+    return m < size ? m : period - 1 - m;
+  } else {
+    if constexpr (POW2) {
+      return static_cast<uint32_t>(x) & (size - 1);
+    } else {
+      int32_t r = x % static_cast<int32_t>(size);
+      return static_cast<uint32_t>(r < 0 ? r + static_cast<int32_t>(size) : r);
+    }
+  }
+}
+
+// CACHED reads go through this thread's texel cache, compressed and virtual
+// images always do since their texels have to be decoded or paged in
+template <int32_t LAYOUT, bool CACHED>
+static inline RGBA fetchTexel(const Image* image, const RGBA* data,
+                              uint32_t x, uint32_t y) {
+  if constexpr (CACHED) {
+    return TexelCache::fetch<LAYOUT>(image, data, x, y);
+  } else {
+    return data[image->getTexelIndex<LAYOUT>(x, y)];
+  }
+}
+
+template <int32_t WRAP_S, int32_t WRAP_T, bool POW2, int32_t LAYOUT,
+          bool CACHED>
+static RGBA sampleNearest(const Image* image, uint32_t layer,
+                          const math::vec2f& uv) {
+  float u = reduceCoord<WRAP_S>(uv.x);
+  float v = reduceCoord<WRAP_T>(uv.y);
+
+  uint32_t x = wrapTexel<WRAP_S, POW2>(
+      floorToInt(u * static_cast<float>(image->mWidth)), image->mWidth);
+  uint32_t y = wrapTexel<WRAP_T, POW2>(
+      floorToInt(v * static_cast<float>(image->mHeight)), image->mHeight);
+
+  return fetchTexel<LAYOUT, CACHED>(image, image->getLayerData(layer), x, y);
+}
+
+// 2x2 texel footprint and 8-bit fractional weights of a bilinear sample,
+// texel centers sit at (i + 0.5) / size
+template <int32_t WRAP_S, int32_t WRAP_T, bool POW2, int32_t LAYOUT,
+          bool CACHED>
+static inline void gatherBilinear(const Image* image, const RGBA* data,
+                                  const math::vec2f& uv, RGBA* texels,
+                                  uint32_t& fx, uint32_t& fy) {
+  float u = reduceCoord<WRAP_S>(uv.x);
+  float v = reduceCoord<WRAP_T>(uv.y);
+
+  // Round to the nearest 1/256 texel, minus the half texel center offset
+  int32_t x = floorToInt(u * static_cast<float>(image->mWidth << 8) - 127.5f);
+  int32_t y = floorToInt(v * static_cast<float>(image->mHeight << 8) - 127.5f);
+
+  fx = static_cast<uint32_t>(x) & 0xFF;
+  fy = static_cast<uint32_t>(y) & 0xFF;
+  x >>= 8;
+  y >>= 8;
+
+  uint32_t left = wrapTexel<WRAP_S, POW2>(x, image->mWidth);
+  uint32_t right = wrapTexel<WRAP_S, POW2>(x + 1, image->mWidth);
+  uint32_t bottom = wrapTexel<WRAP_T, POW2>(y, image->mHeight);
+  uint32_t top = wrapTexel<WRAP_T, POW2>(y + 1, image->mHeight);
+
+  texels[0] = fetchTexel<LAYOUT, CACHED>(image, data, left, bottom);
+  texels[1] = fetchTexel<LAYOUT, CACHED>(image, data, right, bottom);
+  texels[2] = fetchTexel<LAYOUT, CACHED>(image, data, left, top);
+  texels[3] = fetchTexel<LAYOUT, CACHED>(image, data, right, top);
+}
+
+template <int32_t WRAP_S, int32_t WRAP_T, bool POW2, int32_t LAYOUT,
+          bool CACHED>
+static RGBA sampleBilinear(const Image* image, uint32_t layer,
+                           const math::vec2f& uv) {
+  RGBA texels[4];
+  uint32_t fx, fy;
+  gatherBilinear<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>(
+      image, image->getLayerData(layer), uv, texels, fx, fy);
+
+  return Raster::bilinearRGBA(texels[0], texels[1], texels[2], texels[3], fx,
+                              fy);
+}
+
+template <int32_t WRAP_S, int32_t WRAP_T, bool POW2, int32_t LAYOUT,
+          bool CACHED>
+static void sampleNearest4(const Image* image, uint32_t layer,
+                           const math::vec2f* uvs, RGBA* results) {
+  for (int i = 0; i < 4; ++i) {
+    results[i] = sampleNearest<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>(
+        image, layer, uvs[i]);
+  }
+}
+
+template <int32_t WRAP_S, int32_t WRAP_T, bool POW2, int32_t LAYOUT,
+          bool CACHED>
+static void sampleBilinear4(const Image* image, uint32_t layer,
+                            const math::vec2f* uvs, RGBA* results) {
+  const RGBA* data = image->getLayerData(layer);
+  RGBA texels[16];
+  uint32_t fx[4], fy[4];
+  for (int i = 0; i < 4; ++i) {
+    gatherBilinear<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>(
+        image, data, uvs[i], texels + i * 4, fx[i], fy[i]);
+  }
+
+  Raster::bilinearRGBA4(texels, fx, fy, results);
+}
+
+template <int32_t WRAP_S, int32_t WRAP_T, bool POW2, int32_t LAYOUT,
+          bool CACHED>
+static RGBA sampleBilinearSRGB(const Image* image, uint32_t layer,
+                               const math::vec2f& uv) {
+  RGBA texels[4];
+  uint32_t fx, fy;
+  gatherBilinear<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>(
+      image, image->getLayerData(layer), uv, texels, fx, fy);
+
+  return SRGB::bilinear(texels[0], texels[1], texels[2], texels[3], fx, fy);
+}
+
+template <int32_t WRAP_S, int32_t WRAP_T, bool POW2, int32_t LAYOUT,
+          bool CACHED>
+static void sampleBilinearSRGB4(const Image* image, uint32_t layer,
+                                const math::vec2f* uvs, RGBA* results) {
+  for (int i = 0; i < 4; ++i) {
+    results[i] = sampleBilinearSRGB<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>(
+        image, layer, uvs[i]);
+  }
+}
+
+// Bilinear filtering of sRGB images, only used while resolving
+#define SAMPLER_FILTER_LINEAR_SRGB 2
+
+// Flag or'ed into the layout while resolving: read linear and tiled images
+// through the texel cache as well
+#define SAMPLER_LAYOUT_CACHED 0x100
+
+// Runtime state -> template instantiation, one parameter at a time
+template <int32_t FILTER, int32_t WRAP_S, int32_t WRAP_T, bool POW2,
+          int32_t LAYOUT, bool CACHED>
+static void resolveFilter(Sampler::SampleFunc& func,
+                          Sampler::Sample4Func& func4) {
+  if constexpr (FILTER == SAMPLER_FILTER_LINEAR_SRGB) {
+    func = sampleBilinearSRGB<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>;
+    func4 = sampleBilinearSRGB4<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>;
+  } else if constexpr (FILTER == TEXTURE_FILTER_LINEAR) {
+    func = sampleBilinear<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>;
+    func4 = sampleBilinear4<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>;
+  } else {
+    func = sampleNearest<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>;
+    func4 = sampleNearest4<WRAP_S, WRAP_T, POW2, LAYOUT, CACHED>;
+  }
+}
+
+template <int32_t FILTER, int32_t WRAP_S, int32_t WRAP_T, bool POW2>
+static void resolveLayout(int32_t layout, Sampler::SampleFunc& func,
+                          Sampler::Sample4Func& func4) {
+  bool cached = (layout & SAMPLER_LAYOUT_CACHED) != 0;
+  switch (layout & ~SAMPLER_LAYOUT_CACHED) {
+    case IMAGE_LAYOUT_TILED:
+      if (cached) {
+        resolveFilter<FILTER, WRAP_S, WRAP_T, POW2, IMAGE_LAYOUT_TILED, true>(
+            func, func4);
+      } else {
+        resolveFilter<FILTER, WRAP_S, WRAP_T, POW2, IMAGE_LAYOUT_TILED, false>(
+            func, func4);
+      }
+      break;
+    case IMAGE_LAYOUT_VIRTUAL:
+      resolveFilter<FILTER, WRAP_S, WRAP_T, POW2, IMAGE_LAYOUT_VIRTUAL, true>(
+          func, func4);
+      break;
+    case IMAGE_LAYOUT_BC1:
+      resolveFilter<FILTER, WRAP_S, WRAP_T, POW2, IMAGE_LAYOUT_BC1, true>(
+          func, func4);
+      break;
+    case IMAGE_LAYOUT_BC3:
+      resolveFilter<FILTER, WRAP_S, WRAP_T, POW2, IMAGE_LAYOUT_BC3, true>(
+          func, func4);
+      break;
+    default:
+      if (cached) {
+        resolveFilter<FILTER, WRAP_S, WRAP_T, POW2, IMAGE_LAYOUT_LINEAR, true>(
+            func, func4);
+      } else {
+        resolveFilter<FILTER, WRAP_S, WRAP_T, POW2, IMAGE_LAYOUT_LINEAR,
+                      false>(func, func4);
+      }
+      break;
+  }
+}
+
+template <int32_t FILTER, int32_t WRAP_S, int32_t WRAP_T>
+static void resolvePow2(bool pow2, int32_t layout, Sampler::SampleFunc& func,
+                        Sampler::Sample4Func& func4) {
+  if (pow2) {
+    resolveLayout<FILTER, WRAP_S, WRAP_T, true>(layout, func, func4);
+  } else {
+    resolveLayout<FILTER, WRAP_S, WRAP_T, false>(layout, func, func4);
+  }
+}
+
+template <int32_t FILTER, int32_t WRAP_S>
+static void resolveWrapT(int32_t wrapT, bool pow2, int32_t layout,
+                         Sampler::SampleFunc& func,
+                         Sampler::Sample4Func& func4) {
+  switch (wrapT) {
+    case TEXTURE_WRAP_MIRROR:
+      resolvePow2<FILTER, WRAP_S, TEXTURE_WRAP_MIRROR>(pow2, layout, func,
+                                                       func4);
+      break;
+    case TEXTURE_WRAP_CLAMP_TO_EDGE:
+      resolvePow2<FILTER, WRAP_S, TEXTURE_WRAP_CLAMP_TO_EDGE>(pow2, layout,
+                                                              func, func4);
+      break;
+    default:
+      resolvePow2<FILTER, WRAP_S, TEXTURE_WRAP_REPEAT>(pow2, layout, func,
+                                                       func4);
+      break;
+  }
+}
+
+template <int32_t FILTER>
+static void resolveWrapS(int32_t wrapS, int32_t wrapT, bool pow2,
+                         int32_t layout, Sampler::SampleFunc& func,
+                         Sampler::Sample4Func& func4) {
+  switch (wrapS) {
+    case TEXTURE_WRAP_MIRROR:
+      resolveWrapT<FILTER, TEXTURE_WRAP_MIRROR>(wrapT, pow2, layout, func,
+                                                func4);
+      break;
+    case TEXTURE_WRAP_CLAMP_TO_EDGE:
+      resolveWrapT<FILTER, TEXTURE_WRAP_CLAMP_TO_EDGE>(wrapT, pow2, layout,
+                                                       func, func4);
+      break;
+    default:
+      resolveWrapT<FILTER, TEXTURE_WRAP_REPEAT>(wrapT, pow2, layout, func,
+                                                func4);
+      break;
+  }
+}
+
+static bool isPowerOfTwo(uint32_t v) { return v && !(v & (v - 1)); }
+
+Sampler::Sampler() {}
+
+Sampler::~Sampler() {}
+
+void Sampler::setImage(const Image* image) {
+  mImage = image;
+  update();
+}
+
+void Sampler::setWrapMode(int32_t wrapS, int32_t wrapT) {
+  mWrapS = wrapS;
+  mWrapT = wrapT;
+  update();
+}
+
+void Sampler::setFilter(int32_t filter) {
+  mFilter = filter;
+  update();
+}
+
+void Sampler::setCached(bool cached) {
+  mCached = cached;
+  update();
+}
+
+void Sampler::update() const {
+  if (!mImage) {
+    mSampleFunc = nullptr;
+    mSample4Func = nullptr;
+    return;
+  }
+
+  mImageLayout = mImage->mLayout;
+  mImageSRGB = mImage->mSRGB;
+
+  // Every mip level of a power-of-two image is power-of-two as well
+  bool pow2 = isPowerOfTwo(mImage->mWidth) && isPowerOfTwo(mImage->mHeight);
+
+  int32_t layout = mImage->mLayout | (mCached ? SAMPLER_LAYOUT_CACHED : 0);
+  if (mFilter == TEXTURE_FILTER_LINEAR && mImage->mSRGB) {
+    resolveWrapS<SAMPLER_FILTER_LINEAR_SRGB>(mWrapS, mWrapT, pow2, layout,
+                                             mSampleFunc, mSample4Func);
+  } else if (mFilter == TEXTURE_FILTER_LINEAR) {
+    resolveWrapS<TEXTURE_FILTER_LINEAR>(mWrapS, mWrapT, pow2, layout,
+                                        mSampleFunc, mSample4Func);
+  } else {
+    resolveWrapS<TEXTURE_FILTER_NEAREST>(mWrapS, mWrapT, pow2, layout,
+                                         mSampleFunc, mSample4Func);
+  }
+}
+
+RGBA Sampler::sample(const math::vec2f& uv, float lod, uint32_t layer) const {
+  validate();
+  if (mMipmapMode == TEXTURE_MIPMAP_NONE || lod <= 0.0f) {
+    return mSampleFunc(mImage, layer, uv);
+  }
+
+  float maxLevel = static_cast<float>(mImage->getMipLevels() - 1);
+  lod = std::min(lod, maxLevel);
+
+  if (mMipmapMode == TEXTURE_MIPMAP_NEAREST) {
+    auto level = static_cast<uint32_t>(lod + 0.5f);
+    return mSampleFunc(mImage->getMipmap(level), layer, uv);
+  }
+
+  // TEXTURE_MIPMAP_LINEAR: blend the two nearest levels
+  auto level = static_cast<uint32_t>(lod);
+  RGBA color0 = mSampleFunc(mImage->getMipmap(level), layer, uv);
+  RGBA color1 = mSampleFunc(mImage->getMipmap(level + 1), layer, uv);
+
+  float weight = lod - static_cast<float>(level);
+  if (mImage->mSRGB) {
+    return SRGB::lerp(color0, color1, weight);
+  }
+  return Raster::lerpRGBA(color0, color1, weight);
+}
+
+void Sampler::sample4(const math::vec2f* uvs, float lod, RGBA* results,
+                      uint32_t layer) const {
+  validate();
+  if (mMipmapMode == TEXTURE_MIPMAP_NONE || lod <= 0.0f) {
+    mSample4Func(mImage, layer, uvs, results);
+    return;
+  }
+
+  float maxLevel = static_cast<float>(mImage->getMipLevels() - 1);
+  lod = std::min(lod, maxLevel);
+
+  if (mMipmapMode == TEXTURE_MIPMAP_NEAREST) {
+    auto level = static_cast<uint32_t>(lod + 0.5f);
+    mSample4Func(mImage->getMipmap(level), layer, uvs, results);
+    return;
+  }
+
+  auto level = static_cast<uint32_t>(lod);
+  RGBA colors[4];
+  mSample4Func(mImage->getMipmap(level), layer, uvs, results);
+  mSample4Func(mImage->getMipmap(level + 1), layer, uvs, colors);
+
+  float weight = lod - static_cast<float>(level);
+  for (int i = 0; i < 4; ++i) {
+    results[i] = mImage->mSRGB
+                     ? SRGB::lerp(results[i], colors[i], weight)
+                     : Raster::lerpRGBA(results[i], colors[i], weight);
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "../application/image.h"
+#include "../global/base.h"
+
+// Texture sampling state: wrap S/T, filter and mipmap mode of one bound
+// image. The per-level sample function is resolved to a template
+// instantiation specialized for wrap, filter, power-of-two size and image
+// layout whenever that state changes, so sampling itself has no mode branches
+class Sampler {
+ public:
+  using SampleFunc = RGBA (*)(const Image* image, uint32_t layer,
+                              const math::vec2f& uv);
+  using Sample4Func = void (*)(const Image* image, uint32_t layer,
+                               const math::vec2f* uvs, RGBA* results);
+
+  Sampler();
+  ~Sampler();
+
+  // The image's layout and sRGB flag are checked again on every sample, so
+  // Image::setLayout and setSRGB need no rebind
+  void setImage(const Image* image);
+  const Image* getImage() const { return mImage; }
+
+  void setWrapMode(int32_t wrapS, int32_t wrapT);
+  void setFilter(int32_t filter);
+  void setMipmapMode(int32_t mode) { mMipmapMode = mode; }
+
+  // Read linear and tiled images through the per-thread TexelCache too,
+  // compressed and virtual ones always are
+  void setCached(bool cached);
+
+  // layer selects the slice of a texture array, 0 for plain images
+  RGBA sample(const math::vec2f& uv, float lod, uint32_t layer = 0) const;
+  void sample4(const math::vec2f* uvs, float lod, RGBA* results,
+               uint32_t layer = 0) const;
+
+ private:
+  // Resolve the sample functions for the current state and image
+  void update() const;
+
+  // Re-resolve if the image's layout or sRGB flag changed since
+  void validate() const {
+    if (mImage->mLayout != mImageLayout || mImage->mSRGB != mImageSRGB) {
+      update();
+    }
+  }
+
+  const Image* mImage{nullptr};
+
+  int32_t mWrapS{TEXTURE_WRAP_REPEAT};
+  int32_t mWrapT{TEXTURE_WRAP_REPEAT};
+  int32_t mFilter{TEXTURE_FILTER_NEAREST};
+  int32_t mMipmapMode{TEXTURE_MIPMAP_NONE};
+  bool mCached{false};
+
+  // Resolved by update, for the layout and sRGB flag mImage had then
+  mutable int32_t mImageLayout{IMAGE_LAYOUT_LINEAR};
+  mutable bool mImageSRGB{false};
+  mutable SampleFunc mSampleFunc{nullptr};
+  mutable Sample4Func mSample4Func{nullptr};
+};
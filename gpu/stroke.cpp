@@ -0,0 +1,139 @@
+#include "stroke.h"
+
+// Vertex at position, with the attributes of source
+static Point strokeVertex(const Point& source, const math::vec2f& position) {
+  Point p = source;
+  p.x = static_cast<int32_t>(std::lround(position.x));
+  p.y = static_cast<int32_t>(std::lround(position.y));
+  return p;
+}
+
+static void appendTriangle(std::vector<Point>& triangles, const Point& p0,
+                           const Point& p1, const Point& p2) {
+  triangles.push_back(p0);
+  triangles.push_back(p1);
+  triangles.push_back(p2);
+}
+
+// Fan around center from center + from, turning by angle (radians, positive
+// from x towards y). Step count keeps each chord within the tolerance
+static void appendFan(std::vector<Point>& triangles, const Point& center,
+                      const math::vec2f& from, float angle, float radius) {
+  float step = 2.0f * std::acos(std::max(1.0f - STROKE_ROUND_TOLERANCE / radius,
+                                         -1.0f));
+  int count = std::max(1, static_cast<int>(std::ceil(std::abs(angle) / step)));
+  float delta = angle / static_cast<float>(count);
+  float cosDelta = std::cos(delta);
+  float sinDelta = std::sin(delta);
+
+  math::vec2f origin(static_cast<float>(center.x),
+                     static_cast<float>(center.y));
+  math::vec2f offset = from;
+  Point previous = strokeVertex(center, origin + offset);
+  for (int i = 0; i < count; ++i) {
+    offset = math::vec2f(offset.x * cosDelta - offset.y * sinDelta,
+                         offset.x * sinDelta + offset.y * cosDelta);
+    Point next = strokeVertex(center, origin + offset);
+    appendTriangle(triangles, center, previous, next);
+    previous = next;
+  }
+}
+
+void Stroke::tessellate(const std::vector<Point>& points, float width,
+                        int32_t join, int32_t cap,
+                        std::vector<Point>& triangles) {
+  // Repeated points have no direction, only distinct ones are stroked
+  std::vector<const Point*> path;
+  path.reserve(points.size());
+  for (auto& p : points) {
+    if (path.empty() || path.back()->x != p.x || path.back()->y != p.y) {
+      path.push_back(&p);
+    }
+  }
+  if (path.size() < 2 || width <= 0.0f) {
+    return;
+  }
+
+  float half = width * 0.5f;
+  auto position = [](const Point* p) {
+    return math::vec2f(static_cast<float>(p->x), static_cast<float>(p->y));
+  };
+  auto direction = [&](size_t segment) {
+    math::vec2f d = position(path[segment + 1]) - position(path[segment]);
+    return d / math::length(d);
+  };
+  // Left of the direction, half a width long
+  auto normal = [half](const math::vec2f& d) {
+    return math::vec2f(-d.y, d.x) * half;
+  };
+
+  size_t segments = path.size() - 1;
+  math::vec2f d0 = direction(0);
+  for (size_t s = 0; s < segments; ++s) {
+    const Point& p = *path[s];
+    const Point& q = *path[s + 1];
+    math::vec2f start = position(&p);
+    math::vec2f end = position(&q);
+    math::vec2f n = normal(d0);
+
+    if (cap == LINE_CAP_SQUARE && s == 0) {
+      start -= d0 * half;
+    }
+    if (cap == LINE_CAP_SQUARE && s + 1 == segments) {
+      end += d0 * half;
+    }
+
+    Point startLeft = strokeVertex(p, start + n);
+    Point startRight = strokeVertex(p, start - n);
+    Point endLeft = strokeVertex(q, end + n);
+    Point endRight = strokeVertex(q, end - n);
+    appendTriangle(triangles, startLeft, startRight, endLeft);
+    appendTriangle(triangles, startRight, endRight, endLeft);
+
+    if (cap == LINE_CAP_ROUND && s == 0) {
+      // Half turn from the left side back over the start
+      appendFan(triangles, p, n, PI, half);
+    }
+    if (cap == LINE_CAP_ROUND && s + 1 == segments) {
+      appendFan(triangles, q, n, -PI, half);
+    }
+    if (s + 1 == segments) {
+      break;
+    }
+
+    // Join at q with the next segment, on the outer side of the turn
+    math::vec2f d1 = direction(s + 1);
+    float turn = math::cross(d0, d1);
+    float straight = math::dot(d0, d1);
+    if (std::abs(turn) < 1e-6f && straight > 0.0f) {
+      d0 = d1;
+      continue;
+    }
+
+    float side = turn > 0.0f ? -1.0f : 1.0f;
+    math::vec2f outer0 = n * side;
+    math::vec2f outer1 = normal(d1) * side;
+    Point corner0 = strokeVertex(q, end + outer0);
+    Point corner1 = strokeVertex(q, end + outer1);
+
+    if (join == LINE_JOIN_ROUND) {
+      float angle = std::atan2(math::cross(outer0, outer1),
+                               math::dot(outer0, outer1));
+      appendFan(triangles, q, outer0, angle, half);
+    } else {
+      // Miter length over half width is 1 / cos(theta / 2)
+      float cosHalf = std::sqrt(std::max((1.0f + straight) * 0.5f, 0.0f));
+      if (join == LINE_JOIN_MITER && cosHalf * STROKE_MITER_LIMIT > 1.0f) {
+        math::vec2f miter = outer0 + outer1;
+        miter = miter * (half / (math::length(miter) * cosHalf));
+        Point tip = strokeVertex(q, end + miter);
+        appendTriangle(triangles, q, corner0, tip);
+        appendTriangle(triangles, q, tip, corner1);
+      } else {
+        appendTriangle(triangles, q, corner0, corner1);
+      }
+    }
+
+    d0 = d1;
+  }
+}
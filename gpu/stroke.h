@@ -0,0 +1,24 @@
+#pragma once
+#include "../global/base.h"
+#include "math/math.h"
+
+// Longest miter, in half widths, before a join falls back to bevel
+#define STROKE_MITER_LIMIT 4.0f
+
+// Largest distance in pixels between a round join or cap and its polygon
+#define STROKE_ROUND_TOLERANCE 0.25f
+
+// Turns polylines into triangles, so that wide lines go through the
+// triangle path. Every segment becomes a quad, joins and caps add fans or
+// single triangles on the outside. Colors are taken from the polyline
+// points, everything else (uv, texture unit) from the point each vertex
+// belongs to
+class Stroke {
+ public:
+  // Append the triangles of points stroked width pixels wide, with
+  // LINE_JOIN_* joins and LINE_CAP_* caps, three vertices per triangle.
+  // Segments overlap on the inner side of joins, which shows when blending
+  static void tessellate(const std::vector<Point>& points, float width,
+                         int32_t join, int32_t cap,
+                         std::vector<Point>& triangles);
+};
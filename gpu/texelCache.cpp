@@ -0,0 +1,37 @@
+#include "texelCache.h"
+
+std::mutex TexelCache::sCountersMutex;
+std::vector<std::unique_ptr<TexelCache::Counters>> TexelCache::sCounters;
+
+TexelCache::Counters* TexelCache::registerCounters() {
+  std::lock_guard<std::mutex> lock(sCountersMutex);
+  sCounters.push_back(std::make_unique<Counters>());
+  return sCounters.back().get();
+}
+
+TexelCache::Stats TexelCache::getStats() {
+  std::lock_guard<std::mutex> lock(sCountersMutex);
+
+  Stats stats;
+  for (auto& counters : sCounters) {
+    stats.mHits += counters->mHits.load(std::memory_order_relaxed);
+    stats.mMisses += counters->mMisses.load(std::memory_order_relaxed);
+  }
+
+  return stats;
+}
+
+void TexelCache::resetStats() {
+  std::lock_guard<std::mutex> lock(sCountersMutex);
+  for (auto& counters : sCounters) {
+    counters->mHits.store(0, std::memory_order_relaxed);
+    counters->mMisses.store(0, std::memory_order_relaxed);
+  }
+}
+
+void TexelCache::invalidate(uint32_t epoch) {
+  for (auto& block : mBlocks) {
+    block.mSource = nullptr;
+  }
+  mEpoch = epoch;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "../application/blockCompression.h"
+#include "../application/image.h"
+#include "../application/virtualTexture.h"
+#include "../global/base.h"
+
+// 4x4 texel blocks per thread, 4KB of texels
+#define TEXEL_CACHE_SIZE 64
+
+// Software texture cache of 4x4 texel blocks, one per thread and
+// direct-mapped by block position modulo 8x8, so that a sample footprint and
+// its neighbours never collide. Compressed and virtual images always read
+// through it: a block is decoded or paged in once per miss. Linear and tiled
+// images only do when the sampler asks for it, e.g. to measure locality
+class TexelCache {
+ public:
+  struct Stats {
+    uint64_t mHits{0};
+    uint64_t mMisses{0};
+  };
+
+  template <int32_t LAYOUT>
+  static RGBA fetch(const Image* image, const RGBA* data, uint32_t x,
+                    uint32_t y) {
+    const RGBA* texels = sInstance.fetchBlock<LAYOUT>(
+        image, data, x >> IMAGE_TILE_SHIFT, y >> IMAGE_TILE_SHIFT);
+    return texels[((y & IMAGE_TILE_MASK) << IMAGE_TILE_SHIFT) +
+                  (x & IMAGE_TILE_MASK)];
+  }
+
+  // Summed over every thread that has sampled through a cache
+  static Stats getStats();
+
+  // Not synchronized with sampling threads, call between frames
+  static void resetStats();
+
+ private:
+  // Written by the owning thread only, read by getStats from any thread
+  struct Counters {
+    std::atomic<uint64_t> mHits{0};
+    std::atomic<uint64_t> mMisses{0};
+  };
+
+  struct Block {
+    const void* mSource{nullptr};
+    uint32_t mIndex{0};
+    RGBA mTexels[IMAGE_TILE_SIZE * IMAGE_TILE_SIZE];
+  };
+
+  static void increment(std::atomic<uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+  }
+
+  template <int32_t LAYOUT>
+  const RGBA* fetchBlock(const Image* image, const RGBA* data, uint32_t bx,
+                         uint32_t by) {
+    uint32_t epoch = Image::getDataEpoch();
+    if (mEpoch != epoch) {
+      invalidate(epoch);
+    }
+
+    // Virtual levels have no data of their own, the level image stands in
+    const void* source = data;
+    if constexpr (LAYOUT == IMAGE_LAYOUT_VIRTUAL) {
+      source = image;
+    }
+    uint32_t index =
+        by * ((image->mWidth + IMAGE_TILE_MASK) >> IMAGE_TILE_SHIFT) + bx;
+
+    // Registered on first use, sInstance must stay constant initialized
+    if (!mCounters) {
+      mCounters = registerCounters();
+    }
+
+    Block& block = mBlocks[(bx & 7) | ((by & 7) << 3)];
+    if (block.mSource == source && block.mIndex == index) {
+      increment(mCounters->mHits);
+      return block.mTexels;
+    }
+
+    increment(mCounters->mMisses);
+
+    fill<LAYOUT>(image, data, bx, by, block.mTexels);
+    block.mSource = source;
+    block.mIndex = index;
+    return block.mTexels;
+  }
+
+  template <int32_t LAYOUT>
+  static void fill(const Image* image, const RGBA* data, uint32_t bx,
+                   uint32_t by, RGBA* texels) {
+    if constexpr (LAYOUT == IMAGE_LAYOUT_VIRTUAL) {
+      image->mVirtual->getBlock(image->mVirtualLevel, bx, by, texels);
+    } else if constexpr (LAYOUT == IMAGE_LAYOUT_BC1) {
+      BlockCompression::decodeBC1(
+          image->getBlock<BC1_BLOCK_BYTES>(data, bx << IMAGE_TILE_SHIFT,
+                                           by << IMAGE_TILE_SHIFT),
+          texels);
+    } else if constexpr (LAYOUT == IMAGE_LAYOUT_BC3) {
+      BlockCompression::decodeBC3(
+          image->getBlock<BC3_BLOCK_BYTES>(data, bx << IMAGE_TILE_SHIFT,
+                                           by << IMAGE_TILE_SHIFT),
+          texels);
+    } else if constexpr (LAYOUT == IMAGE_LAYOUT_TILED) {
+      memcpy(texels,
+             data + image->getTexelIndex<IMAGE_LAYOUT_TILED>(
+                        bx << IMAGE_TILE_SHIFT, by << IMAGE_TILE_SHIFT),
+             sizeof(RGBA) * IMAGE_TILE_SIZE * IMAGE_TILE_SIZE);
+    } else {
+      // Edge blocks replicate the last row/column like tiled storage does
+      for (uint32_t j = 0; j < IMAGE_TILE_SIZE; ++j) {
+        uint32_t y =
+            std::min((by << IMAGE_TILE_SHIFT) + j, image->mHeight - 1);
+        for (uint32_t i = 0; i < IMAGE_TILE_SIZE; ++i) {
+          uint32_t x =
+              std::min((bx << IMAGE_TILE_SHIFT) + i, image->mWidth - 1);
+          texels[(j << IMAGE_TILE_SHIFT) + i] =
+              data[image->getTexelIndex<IMAGE_LAYOUT_LINEAR>(x, y)];
+        }
+      }
+    }
+  }
+
+  // Drop every block, texel memory they were read from may have been reused
+  void invalidate(uint32_t epoch);
+
+  static Counters* registerCounters();
+
+  static thread_local TexelCache sInstance;
+
+  // Counters outlive their threads, so totals keep what finished threads did
+  static std::mutex sCountersMutex;
+  static std::vector<std::unique_ptr<Counters>> sCounters;
+
+  uint32_t mEpoch{0};
+  Counters* mCounters{nullptr};
+  Block mBlocks[TEXEL_CACHE_SIZE];
+};
+
+// Defined inline and constant initialized, so that access needs no
+// per-thread init check
+inline thread_local TexelCache TexelCache::sInstance;
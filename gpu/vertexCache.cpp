@@ -0,0 +1,183 @@
+#include "vertexCache.h"
+
+#include <algorithm>
+
+void VertexCache::configure(uint32_t size, int32_t policy) {
+  mEntries.assign(size, Entry());
+  mPolicy = policy;
+  mClock = 0;
+}
+
+void VertexCache::reset() {
+  for (auto& entry : mEntries) {
+    entry.mStamp = 0;
+  }
+  mClock = 0;
+  mStats = Stats();
+}
+
+bool VertexCache::lookup(uint32_t index, Vertex& vertex) {
+  for (auto& entry : mEntries) {
+    if (entry.mStamp != 0 && entry.mIndex == index) {
+      if (mPolicy == VERTEX_CACHE_LRU) {
+        entry.mStamp = ++mClock;
+      }
+      vertex = entry.mVertex;
+      ++mStats.mHits;
+      return true;
+    }
+  }
+
+  ++mStats.mMisses;
+  return false;
+}
+
+void VertexCache::insert(uint32_t index, const Vertex& vertex) {
+  if (mEntries.empty()) {
+    return;
+  }
+
+  // Empty entries have the lowest stamp and fill up first
+  auto victim = std::min_element(
+      mEntries.begin(), mEntries.end(),
+      [](const Entry& a, const Entry& b) { return a.mStamp < b.mStamp; });
+  victim->mIndex = index;
+  victim->mStamp = ++mClock;
+  victim->mVertex = vertex;
+}
+
+// Forsyth's vertex score: high for vertices recently used and for vertices
+// with few triangles left, so that those get finished off instead of being
+// left behind as isolated triangles
+static float vertexScore(int32_t cachePosition, uint32_t valence) {
+  if (valence == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // Vertices of the last triangle, a fixed score keeps strips from
+      // turning back on themselves
+      score = 0.75f;
+    } else {
+      float scale = 1.0f / (VERTEX_CACHE_OPTIMIZE_SIZE - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+    }
+  }
+
+  score += 2.0f / std::sqrt(static_cast<float>(valence));
+  return score;
+}
+
+void VertexCache::optimize(std::vector<uint32_t>& indices,
+                           size_t vertexCount) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Triangles not yet emitted of every vertex, adjacency[start[v]..] holds
+  // the first valence[v] of them
+  std::vector<uint32_t> valence(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    assert(indices[i] < vertexCount);
+    ++valence[indices[i]];
+  }
+  std::vector<uint32_t> start(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    start[v + 1] = start[v] + valence[v];
+  }
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+  for (size_t t = 0; t < triangleCount; ++t) {
+    for (size_t k = 0; k < 3; ++k) {
+      adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<float> scores(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    scores[v] = vertexScore(-1, valence[v]);
+  }
+
+  // Modelled LRU cache, most recent first. It briefly holds three extra
+  // vertices while a triangle is pushed
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> nextCache;
+  cache.reserve(VERTEX_CACHE_OPTIMIZE_SIZE + 3);
+  nextCache.reserve(VERTEX_CACHE_OPTIMIZE_SIZE + 3);
+
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+
+  size_t scanCursor = 0;
+  int64_t best = -1;
+  for (size_t n = 0; n < triangleCount; ++n) {
+    if (best < 0) {
+      // Nothing in the cache to continue with, start over at the next
+      // triangle left in input order
+      while (emitted[scanCursor]) {
+        ++scanCursor;
+      }
+      best = static_cast<int64_t>(scanCursor);
+    }
+
+    const uint32_t* triangle = &indices[best * 3];
+    emitted[best] = true;
+    output.insert(output.end(), triangle, triangle + 3);
+
+    // Take the triangle off its vertices' lists, one entry per corner
+    for (size_t k = 0; k < 3; ++k) {
+      uint32_t v = triangle[k];
+      uint32_t* first = &adjacency[start[v]];
+      uint32_t* last = first + valence[v];
+      *std::find(first, last, static_cast<uint32_t>(best)) = *(last - 1);
+      --valence[v];
+    }
+
+    // Push the triangle's vertices to the front, once each
+    nextCache.clear();
+    for (size_t k = 0; k < 3; ++k) {
+      if (std::find(triangle, triangle + k, triangle[k]) == triangle + k) {
+        nextCache.push_back(triangle[k]);
+      }
+    }
+    for (uint32_t v : cache) {
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        nextCache.push_back(v);
+      }
+    }
+    for (size_t i = VERTEX_CACHE_OPTIMIZE_SIZE; i < nextCache.size(); ++i) {
+      scores[nextCache[i]] = vertexScore(-1, valence[nextCache[i]]);
+    }
+    if (nextCache.size() > VERTEX_CACHE_OPTIMIZE_SIZE) {
+      nextCache.resize(VERTEX_CACHE_OPTIMIZE_SIZE);
+    }
+    cache.swap(nextCache);
+
+    for (size_t i = 0; i < cache.size(); ++i) {
+      scores[cache[i]] =
+          vertexScore(static_cast<int32_t>(i), valence[cache[i]]);
+    }
+
+    // Next triangle: the best scoring one touching the cache
+    best = -1;
+    float bestScore = -1.0f;
+    for (uint32_t v : cache) {
+      for (uint32_t i = 0; i < valence[v]; ++i) {
+        uint32_t t = adjacency[start[v] + i];
+        const uint32_t* candidate = &indices[t * 3];
+        float score = scores[candidate[0]] + scores[candidate[1]] +
+                      scores[candidate[2]];
+        if (score > bestScore) {
+          bestScore = score;
+          best = t;
+        }
+      }
+    }
+  }
+
+  std::copy(output.begin(), output.end(), indices.begin());
+}
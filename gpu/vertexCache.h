@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+
+#include "../global/base.h"
+
+// Replacement policies of the post-transform cache: FIFO evicts the vertex
+// transformed longest ago, LRU the one used longest ago
+#define VERTEX_CACHE_FIFO 0
+#define VERTEX_CACHE_LRU 1
+
+#define VERTEX_CACHE_DEFAULT_SIZE 32
+
+// Cache size modelled by VertexCache::optimize
+#define VERTEX_CACHE_OPTIMIZE_SIZE 32
+
+// Post-transform vertex cache of indexed draws, keyed by vertex index. A
+// vertex shared by several triangles is transformed once as long as it is
+// still cached when it comes up again, so the hit rate depends on index
+// order, see optimize. Entries are searched linearly, sizes are small
+class VertexCache {
+ public:
+  VertexCache() : mEntries(VERTEX_CACHE_DEFAULT_SIZE) {}
+
+  struct Stats {
+    uint64_t mHits{0};
+    uint64_t mMisses{0};
+  };
+
+  // Output of the vertex stage: pixel position and clip w, w <= 0 is
+  // behind the eye
+  struct Vertex {
+    int32_t mX{0};
+    int32_t mY{0};
+    float mW{1.0f};
+  };
+
+  // Size 0 disables caching, every index is a miss
+  void configure(uint32_t size, int32_t policy);
+
+  // Drop all entries and zero the stats, at the start of every draw
+  void reset();
+
+  // Copy the cached vertex of index into vertex, counting a hit or a miss
+  bool lookup(uint32_t index, Vertex& vertex);
+
+  // Cache vertex after a miss, evicting by policy
+  void insert(uint32_t index, const Vertex& vertex);
+
+  const Stats& getStats() const { return mStats; }
+
+  // Reorder the triangles of an index list (three indices each) for a LRU
+  // cache of VERTEX_CACHE_OPTIMIZE_SIZE, with Tom Forsyth's linear-speed
+  // vertex cache optimisation. Meant to run once when a mesh is loaded.
+  // Indices must be below vertexCount
+  static void optimize(std::vector<uint32_t>& indices, size_t vertexCount);
+
+ private:
+  struct Entry {
+    uint32_t mIndex{0};
+    // Insertion (FIFO) or last use (LRU) time, 0 for an empty entry
+    uint64_t mStamp{0};
+    Vertex mVertex;
+  };
+
+  std::vector<Entry> mEntries;
+  int32_t mPolicy{VERTEX_CACHE_LRU};
+  uint64_t mClock{0};
+  Stats mStats;
+};
@@ -0,0 +1,180 @@
+#include "vertexStream.h"
+
+#include <algorithm>
+
+VertexStream::VertexStream(uint32_t format)
+    : mFormat(format | VERTEX_ATTRIB_POSITION) {}
+
+VertexStream::~VertexStream() {
+  delete[] mLanes;
+  delete[] mColorLanes;
+}
+
+void VertexStream::resize(size_t count) {
+  reserveBatches((count + VERTEX_STREAM_BATCH - 1) / VERTEX_STREAM_BATCH);
+  if (count > mSize) {
+    initVertices(mSize, count);
+  }
+  mSize = count;
+}
+
+void VertexStream::setFormat(uint32_t format) {
+  delete[] mLanes;
+  delete[] mColorLanes;
+  mLanes = nullptr;
+  mColorLanes = nullptr;
+  mX = mY = mZ = mW = mU = mV = nullptr;
+  mColor = nullptr;
+
+  mFormat = format | VERTEX_ATTRIB_POSITION;
+  mSize = 0;
+  mBatches = 0;
+}
+
+void VertexStream::attach(uint32_t format, size_t count, const float* x,
+                          const float* y, const float* z, const float* w,
+                          const float* u, const float* v, const RGBA* color) {
+  delete[] mLanes;
+  delete[] mColorLanes;
+  mLanes = nullptr;
+  mColorLanes = nullptr;
+
+  mFormat = format | VERTEX_ATTRIB_POSITION;
+  mSize = count;
+  mBatches = (count + VERTEX_STREAM_BATCH - 1) / VERTEX_STREAM_BATCH;
+  mX = const_cast<float*>(x);
+  mY = const_cast<float*>(y);
+  mZ = const_cast<float*>(z);
+  mW = const_cast<float*>(w);
+  mU = hasAttribute(VERTEX_ATTRIB_UV) ? const_cast<float*>(u) : nullptr;
+  mV = hasAttribute(VERTEX_ATTRIB_UV) ? const_cast<float*>(v) : nullptr;
+  mColor =
+      hasAttribute(VERTEX_ATTRIB_COLOR) ? const_cast<RGBA*>(color) : nullptr;
+}
+
+void VertexStream::push(const math::vec4f& position, const math::vec2f& uv,
+                        const RGBA& color) {
+  if (mSize == capacity()) {
+    reserveBatches(std::max<size_t>(mBatches * 2, 1));
+  }
+
+  size_t i = mSize++;
+  mX[i] = position.x;
+  mY[i] = position.y;
+  mZ[i] = position.z;
+  mW[i] = position.w;
+  if (mU) {
+    mU[i] = uv.x;
+    mV[i] = uv.y;
+  }
+  if (mColor) {
+    mColor[i] = color;
+  }
+}
+
+void VertexStream::perspectiveDivide() {
+  size_t count = mSize;
+  size_t i = 0;
+
+#if defined(SIMD_AVX)
+  __m256 zero = _mm256_setzero_ps();
+  __m256 one = _mm256_set1_ps(1.0f);
+  for (; i < count; i += VERTEX_STREAM_BATCH) {
+    __m256 w = _mm256_load_ps(mW + i);
+    // 1 / w where w > 0, 1 elsewhere
+    __m256 front = _mm256_cmp_ps(w, zero, _CMP_GT_OQ);
+    __m256 inv = _mm256_div_ps(one, _mm256_blendv_ps(one, w, front));
+    _mm256_store_ps(mX + i, _mm256_mul_ps(_mm256_load_ps(mX + i), inv));
+    _mm256_store_ps(mY + i, _mm256_mul_ps(_mm256_load_ps(mY + i), inv));
+    _mm256_store_ps(mZ + i, _mm256_mul_ps(_mm256_load_ps(mZ + i), inv));
+  }
+#elif defined(SIMD_SSE2)
+  __m128 zero = _mm_setzero_ps();
+  __m128 one = _mm_set1_ps(1.0f);
+  for (; i < count; i += 4) {
+    __m128 w = _mm_load_ps(mW + i);
+    __m128 front = _mm_cmpgt_ps(w, zero);
+    __m128 inv = _mm_div_ps(
+        one, _mm_or_ps(_mm_and_ps(front, w), _mm_andnot_ps(front, one)));
+    _mm_store_ps(mX + i, _mm_mul_ps(_mm_load_ps(mX + i), inv));
+    _mm_store_ps(mY + i, _mm_mul_ps(_mm_load_ps(mY + i), inv));
+    _mm_store_ps(mZ + i, _mm_mul_ps(_mm_load_ps(mZ + i), inv));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    if (mW[i] > 0.0f) {
+      float inv = 1.0f / mW[i];
+      mX[i] *= inv;
+      mY[i] *= inv;
+      mZ[i] *= inv;
+    }
+  }
+}
+
+void VertexStream::reserveBatches(size_t batches) {
+  if (batches <= mBatches) {
+    return;
+  }
+
+  uint32_t arrays = hasAttribute(VERTEX_ATTRIB_UV) ? 6 : 4;
+  VertexLanes* lanes = new VertexLanes[batches * arrays];
+  VertexColorLanes* colorLanes = nullptr;
+  if (hasAttribute(VERTEX_ATTRIB_COLOR)) {
+    colorLanes = new VertexColorLanes[batches];
+  }
+
+  // Array k starts at batch k * batches
+  auto array = [&](uint32_t k) { return lanes[k * batches].mValues; };
+  float* x = array(0);
+  float* y = array(1);
+  float* z = array(2);
+  float* w = array(3);
+  float* u = arrays > 4 ? array(4) : nullptr;
+  float* v = arrays > 4 ? array(5) : nullptr;
+  RGBA* color = colorLanes ? colorLanes->mValues : nullptr;
+
+  if (mSize > 0) {
+    std::copy(mX, mX + mSize, x);
+    std::copy(mY, mY + mSize, y);
+    std::copy(mZ, mZ + mSize, z);
+    std::copy(mW, mW + mSize, w);
+    if (u) {
+      std::copy(mU, mU + mSize, u);
+      std::copy(mV, mV + mSize, v);
+    }
+    if (color) {
+      std::copy(mColor, mColor + mSize, color);
+    }
+  }
+
+  delete[] mLanes;
+  delete[] mColorLanes;
+  mLanes = lanes;
+  mColorLanes = colorLanes;
+  mBatches = batches;
+  mX = x;
+  mY = y;
+  mZ = z;
+  mW = w;
+  mU = u;
+  mV = v;
+  mColor = color;
+
+  // Padding past the last vertex stays valid for the batch loops
+  initVertices(mSize, capacity());
+}
+
+void VertexStream::initVertices(size_t first, size_t last) {
+  std::fill(mX + first, mX + last, 0.0f);
+  std::fill(mY + first, mY + last, 0.0f);
+  std::fill(mZ + first, mZ + last, 0.0f);
+  std::fill(mW + first, mW + last, 1.0f);
+  if (mU) {
+    std::fill(mU + first, mU + last, 0.0f);
+    std::fill(mV + first, mV + last, 0.0f);
+  }
+  if (mColor) {
+    std::fill(mColor + first, mColor + last, RGBA());
+  }
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "../global/base.h"
+
+// Attributes of a vertex format, position (x, y, z, w) is always present
+#define VERTEX_ATTRIB_POSITION 0x1
+#define VERTEX_ATTRIB_UV 0x2
+#define VERTEX_ATTRIB_COLOR 0x4
+
+#define VERTEX_FORMAT_POSITION VERTEX_ATTRIB_POSITION
+#define VERTEX_FORMAT_DEFAULT \
+  (VERTEX_ATTRIB_POSITION | VERTEX_ATTRIB_UV | VERTEX_ATTRIB_COLOR)
+
+// Vertices per batch of the vertex stages, one AVX register of floats.
+// Streams are allocated in whole batches so that the stages never need a
+// scalar tail
+#define VERTEX_STREAM_BATCH 8
+
+// Setup clamps pixel positions to this many pixels around the origin, so
+// that vertices close to the eye plane cannot overflow when rounded
+#define VERTEX_GUARD_BAND 16384.0f
+
+// One batch of one attribute, aligned for AVX loads
+struct alignas(32) VertexLanes {
+  float mValues[VERTEX_STREAM_BATCH];
+};
+
+struct alignas(32) VertexColorLanes {
+  RGBA mValues[VERTEX_STREAM_BATCH];
+};
+
+// Vertices in structure-of-arrays form: every attribute of the format is an
+// array of its own, so the transform and setup stages load the same
+// component of VERTEX_STREAM_BATCH vertices with one instruction instead of
+// gathering it out of Points. Positions are floats until setup rounds them
+// to pixels, once per vertex
+class VertexStream {
+ public:
+  explicit VertexStream(uint32_t format = VERTEX_FORMAT_DEFAULT);
+  ~VertexStream();
+  VertexStream(const VertexStream&) = delete;
+  VertexStream& operator=(const VertexStream&) = delete;
+
+  // Set the vertex count, keeping the first vertices. Memory grows in whole
+  // batches and is never given back, new vertices are (0, 0, 0, 1), uv
+  // (0, 0) and white
+  void resize(size_t count);
+  void clear() { mSize = 0; }
+
+  // Switch to another format, dropping all vertices and memory
+  void setFormat(uint32_t format);
+
+  // Use count vertices stored elsewhere instead of own memory, e.g. in a
+  // mapped file. The arrays follow the layout of getX() and friends:
+  // 32-byte aligned, padded with valid vertices to whole batches. Arrays
+  // missing from format are null. Attached arrays are only read by the
+  // stages, resize and push must not be used on them
+  void attach(uint32_t format, size_t count, const float* x, const float* y,
+              const float* z, const float* w, const float* u, const float* v,
+              const RGBA* color);
+
+  // Append a vertex, attributes missing from the format are ignored
+  void push(const math::vec4f& position, const math::vec2f& uv = {},
+            const RGBA& color = RGBA());
+
+  // Divide x, y and z by w. w <= 0 (behind the eye) is left alone, setup
+  // drops triangles touching such vertices
+  void perspectiveDivide();
+
+  // Bounding box of the positions as stored, for culling before the stream
+  // is drawn. w is ignored
+  math::AABB<float> computeBounds() const {
+    return math::computeAABB(mX, mY, mZ, mSize);
+  }
+
+  uint32_t getFormat() const { return mFormat; }
+  bool hasAttribute(uint32_t attrib) const { return (mFormat & attrib) != 0; }
+  size_t size() const { return mSize; }
+
+  // Vertices the arrays have room for, a multiple of VERTEX_STREAM_BATCH.
+  // Entries past size() are valid padding
+  size_t capacity() const { return mBatches * VERTEX_STREAM_BATCH; }
+
+  // Attribute arrays, 32-byte aligned. getU/getV/getColor are null when the
+  // format has no such attribute
+  float* getX() { return mX; }
+  float* getY() { return mY; }
+  float* getZ() { return mZ; }
+  float* getW() { return mW; }
+  float* getU() { return mU; }
+  float* getV() { return mV; }
+  RGBA* getColor() { return mColor; }
+  const float* getX() const { return mX; }
+  const float* getY() const { return mY; }
+  const float* getZ() const { return mZ; }
+  const float* getW() const { return mW; }
+  const float* getU() const { return mU; }
+  const float* getV() const { return mV; }
+  const RGBA* getColor() const { return mColor; }
+
+ private:
+  // Grow to at least batches batches, copying the vertices kept
+  void reserveBatches(size_t batches);
+
+  // Set vertices first..last (exclusive) to the defaults of resize
+  void initVertices(size_t first, size_t last);
+
+  uint32_t mFormat{VERTEX_FORMAT_DEFAULT};
+  size_t mSize{0};
+  size_t mBatches{0};
+
+  // All float attributes in one allocation, mBatches batches each
+  VertexLanes* mLanes{nullptr};
+  VertexColorLanes* mColorLanes{nullptr};
+
+  float* mX{nullptr};
+  float* mY{nullptr};
+  float* mZ{nullptr};
+  float* mW{nullptr};
+  float* mU{nullptr};
+  float* mV{nullptr};
+  RGBA* mColor{nullptr};
+};
@@ -3,9 +3,11 @@
 
 #include "application/application.h"
 #include "application/image.h"
+#include "application/textureManager.h"
 #include "gpu/gpu.h"
 
-Image* texture;
+TextureHandle texture;
+std::future<TextureHandle> textureLoading;
 Point p1;
 Point p2;
 Point p3;
@@ -24,11 +26,25 @@ void changeUV() {
   q3.uv.x += speed;
 }
 
+// Pick up the texture once the loader thread is done, drawing untextured
+// until then
+void checkTexture() {
+  if (texture || !textureLoading.valid()) {
+    return;
+  }
+
+  if (textureLoading.wait_for(std::chrono::seconds(0)) ==
+      std::future_status::ready) {
+    texture = textureLoading.get();
+  }
+}
+
 void render() {
+  checkTexture();
   changeUV();
 
   sgl->clear();
-  sgl->setTexture(texture);
+  sgl->setTexture(texture.get());
   sgl->setWrapMode(TEXTURE_WRAP_MIRROR);
 
   sgl->drawTriangle(p1, p2, p3);
@@ -36,7 +52,8 @@ void render() {
 }
 
 void prepare() {
-  texture = Image::createImage("textures/goku.jpg");
+  texManager->setLayout(IMAGE_LAYOUT_TILED);
+  textureLoading = texManager->loadAsync("textures/goku.jpg");
 
   p1.x = 0;
   p1.y = 0;
@@ -82,9 +99,15 @@ int main(int argc, char* argv[]) {
   while (alive) {
     alive = app->peekMessage();
     render();
+
+    // The canvas is the GPU's color buffer, a frame drawn into an HDR or
+    // multisampled attachment is only there once resolved
+    sgl->resolveAttachments();
     app->show();
   }
 
-  Image::destroyImage(texture);
+  if (textureLoading.valid()) {
+    textureLoading.wait();
+  }
   return 0;
 }
\ No newline at end of file
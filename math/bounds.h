@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "mathFunctions.h"
+#include "simd.h"
+
+namespace math {
+
+/** @brief Axis aligned bounding box, empty while min > max */
+template <typename T>
+class AABB {
+ public:
+  constexpr AABB() : min(1, 1, 1), max(-1, -1, -1) {}
+  constexpr AABB(const Vector3<T>& min, const Vector3<T>& max)
+      : min(min), max(max) {}
+
+  constexpr bool isEmpty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+
+  /** Grow the box to contain p */
+  constexpr void expand(const Vector3<T>& p) {
+    if (isEmpty()) {
+      min = max = p;
+      return;
+    }
+    min = Vector3<T>(std::min(min.x, p.x), std::min(min.y, p.y),
+                     std::min(min.z, p.z));
+    max = Vector3<T>(std::max(max.x, p.x), std::max(max.y, p.y),
+                     std::max(max.z, p.z));
+  }
+
+  constexpr Vector3<T> center() const { return (min + max) / T(2); }
+  constexpr Vector3<T> extent() const { return (max - min) / T(2); }
+
+ public:
+  Vector3<T> min;
+  Vector3<T> max;
+};
+
+/** @brief Bounding sphere */
+template <typename T>
+class Sphere {
+ public:
+  constexpr Sphere() : radius(0) {}
+  constexpr Sphere(const Vector3<T>& center, T radius)
+      : center(center), radius(radius) {}
+
+ public:
+  Vector3<T> center;
+  T radius;
+};
+
+/**
+ * @brief Sphere around a box, centered on it
+ * @param box Non-empty box
+ * @return Smallest sphere with the box's center containing it
+ */
+template <typename T>
+Sphere<T> boundingSphere(const AABB<T>& box) {
+  return Sphere<T>(box.center(), length(box.extent()));
+}
+
+/**
+ * @brief Bounding box of points stored as separate x/y/z arrays
+ * @param x, y, z Point components
+ * @param count Number of points, the box is empty for 0
+ */
+inline AABB<float> computeAABB(const float* x, const float* y, const float* z,
+                               size_t count) {
+  AABB<float> box;
+  if (count == 0) {
+    return box;
+  }
+
+  const float* in[3] = {x, y, z};
+  float lo[3], hi[3];
+  for (int c = 0; c < 3; ++c) {
+    const float* v = in[c];
+    size_t i = 0;
+    lo[c] = hi[c] = v[0];
+#ifdef SIMD_SSE2
+    if (count >= 4) {
+      __m128 vmin = _mm_loadu_ps(v);
+      __m128 vmax = vmin;
+      for (i = 4; i + 4 <= count; i += 4) {
+        __m128 p = _mm_loadu_ps(v + i);
+        vmin = _mm_min_ps(vmin, p);
+        vmax = _mm_max_ps(vmax, p);
+      }
+      alignas(16) float mins[4], maxs[4];
+      _mm_store_ps(mins, vmin);
+      _mm_store_ps(maxs, vmax);
+      lo[c] = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+      hi[c] = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+    }
+#endif
+    for (; i < count; ++i) {
+      lo[c] = std::min(lo[c], v[i]);
+      hi[c] = std::max(hi[c], v[i]);
+    }
+  }
+
+  return AABB<float>(Vector3<float>(lo[0], lo[1], lo[2]),
+                     Vector3<float>(hi[0], hi[1], hi[2]));
+}
+
+#define FRUSTUM_LEFT 0
+#define FRUSTUM_RIGHT 1
+#define FRUSTUM_BOTTOM 2
+#define FRUSTUM_TOP 3
+#define FRUSTUM_NEAR 4
+#define FRUSTUM_FAR 5
+
+/**
+ * @brief Six planes of a view frustum
+ *
+ * Each plane (a, b, c, d) has a unit normal pointing inwards, a point p is
+ * inside when a * p.x + b * p.y + c * p.z + d >= 0 for all of them.
+ */
+template <typename T>
+class Frustum {
+ public:
+  /** Signed distance of p to plane i, negative outside */
+  T distance(int i, const Vector3<T>& p) const {
+    return (planes[i].x * p.x + planes[i].y * p.y) +
+           (planes[i].z * p.z + planes[i].w);
+  }
+
+  bool intersects(const Sphere<T>& sphere) const {
+    for (int i = 0; i < 6; ++i) {
+      if (distance(i, sphere.center) < -sphere.radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** Tests the corner furthest along each plane's normal, conservative:
+   * boxes near frustum corners may pass although outside */
+  bool intersects(const AABB<T>& box) const {
+    for (int i = 0; i < 6; ++i) {
+      Vector3<T> corner(planes[i].x >= 0 ? box.max.x : box.min.x,
+                        planes[i].y >= 0 ? box.max.y : box.min.y,
+                        planes[i].z >= 0 ? box.max.z : box.min.z);
+      if (distance(i, corner) < 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ public:
+  Vector4<T> planes[6];
+};
+
+/**
+ * @brief Extracts the frustum planes of a projection (Gribb/Hartmann)
+ * @param m Projection, or projection * view for world space planes, with
+ *          clip space -w <= x, y, z <= w as produced by perspective and
+ *          orthographic
+ * @return Normalized planes, FRUSTUM_* order
+ */
+template <typename T>
+Frustum<T> extractFrustum(const Matrix44<T>& m) {
+  Vector4<T> row[4];
+  for (uint32_t r = 0; r < 4; ++r) {
+    row[r] = Vector4<T>(m.get(r, 0), m.get(r, 1), m.get(r, 2), m.get(r, 3));
+  }
+
+  Frustum<T> frustum;
+  frustum.planes[FRUSTUM_LEFT] = row[3] + row[0];
+  frustum.planes[FRUSTUM_RIGHT] = row[3] - row[0];
+  frustum.planes[FRUSTUM_BOTTOM] = row[3] + row[1];
+  frustum.planes[FRUSTUM_TOP] = row[3] - row[1];
+  frustum.planes[FRUSTUM_NEAR] = row[3] + row[2];
+  frustum.planes[FRUSTUM_FAR] = row[3] - row[2];
+
+  for (auto& plane : frustum.planes) {
+    T normal = std::sqrt(plane.x * plane.x + plane.y * plane.y +
+                         plane.z * plane.z);
+    plane = plane / normal;
+  }
+
+  return frustum;
+}
+
+/**
+ * @brief Frustum test of count spheres stored as separate arrays
+ * @param frustum Planes in the spheres' space
+ * @param x, y, z, radius Sphere centers and radii
+ * @param visible Set to 1 for spheres intersecting the frustum, else 0
+ * @param count Number of spheres
+ * @return Number of visible spheres
+ *
+ * Each plane is broadcast once and tested against four spheres per
+ * instruction, so a whole scene is culled in one pass before any of its
+ * vertices are touched.
+ */
+inline size_t cullSpheres(const Frustum<float>& frustum, const float* x,
+                          const float* y, const float* z, const float* radius,
+                          uint8_t* visible, size_t count) {
+  const Vector4<float>* planes = frustum.planes;
+  size_t visibleCount = 0;
+  size_t i = 0;
+
+#ifdef SIMD_SSE2
+  for (; i + 4 <= count; i += 4) {
+    __m128 vx = _mm_loadu_ps(x + i);
+    __m128 vy = _mm_loadu_ps(y + i);
+    __m128 vz = _mm_loadu_ps(z + i);
+    __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+    __m128 outside = _mm_setzero_ps();
+    for (int p = 0; p < 6; ++p) {
+      __m128 d = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(planes[p].x)),
+                     _mm_mul_ps(vy, _mm_set1_ps(planes[p].y))),
+          _mm_add_ps(_mm_mul_ps(vz, _mm_set1_ps(planes[p].z)),
+                     _mm_set1_ps(planes[p].w)));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negRadius));
+    }
+    int mask = _mm_movemask_ps(outside);
+    for (int k = 0; k < 4; ++k) {
+      visible[i + k] = static_cast<uint8_t>(((mask >> k) & 1) ^ 1);
+      visibleCount += visible[i + k];
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; ++p) {
+      float d = (x[i] * planes[p].x + y[i] * planes[p].y) +
+                (z[i] * planes[p].z + planes[p].w);
+      inside = !(d < -radius[i]);
+    }
+    visible[i] = inside ? 1 : 0;
+    visibleCount += visible[i];
+  }
+
+  return visibleCount;
+}
+
+/**
+ * @brief Frustum test of count boxes stored as separate arrays
+ * @param frustum Planes in the boxes' space
+ * @param minX, minY, minZ, maxX, maxY, maxZ Box corners
+ * @param visible Set to 1 for boxes intersecting the frustum, else 0
+ * @param count Number of boxes
+ * @return Number of visible boxes
+ *
+ * Same test as Frustum::intersects(AABB). The corner to test only depends
+ * on the signs of the plane normal, so it is picked per plane and not per
+ * box.
+ */
+inline size_t cullBoxes(const Frustum<float>& frustum, const float* minX,
+                        const float* minY, const float* minZ,
+                        const float* maxX, const float* maxY,
+                        const float* maxZ, uint8_t* visible, size_t count) {
+  const Vector4<float>* planes = frustum.planes;
+  const float* cornerX[6];
+  const float* cornerY[6];
+  const float* cornerZ[6];
+  for (int p = 0; p < 6; ++p) {
+    cornerX[p] = planes[p].x >= 0 ? maxX : minX;
+    cornerY[p] = planes[p].y >= 0 ? maxY : minY;
+    cornerZ[p] = planes[p].z >= 0 ? maxZ : minZ;
+  }
+
+  size_t visibleCount = 0;
+  size_t i = 0;
+
+#ifdef SIMD_SSE2
+  for (; i + 4 <= count; i += 4) {
+    __m128 outside = _mm_setzero_ps();
+    for (int p = 0; p < 6; ++p) {
+      __m128 d = _mm_add_ps(
+          _mm_add_ps(
+              _mm_mul_ps(_mm_loadu_ps(cornerX[p] + i),
+                         _mm_set1_ps(planes[p].x)),
+              _mm_mul_ps(_mm_loadu_ps(cornerY[p] + i),
+                         _mm_set1_ps(planes[p].y))),
+          _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(cornerZ[p] + i),
+                                _mm_set1_ps(planes[p].z)),
+                     _mm_set1_ps(planes[p].w)));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(d, _mm_setzero_ps()));
+    }
+    int mask = _mm_movemask_ps(outside);
+    for (int k = 0; k < 4; ++k) {
+      visible[i + k] = static_cast<uint8_t>(((mask >> k) & 1) ^ 1);
+      visibleCount += visible[i + k];
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; ++p) {
+      float d = (cornerX[p][i] * planes[p].x + cornerY[p][i] * planes[p].y) +
+                (cornerZ[p][i] * planes[p].z + planes[p].w);
+      inside = !(d < 0.0f);
+    }
+    visible[i] = inside ? 1 : 0;
+    visibleCount += visible[i];
+  }
+
+  return visibleCount;
+}
+}  // namespace math
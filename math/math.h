@@ -1,4 +1,6 @@
 #pragma once
 
+#include "bounds.h"
 #include "mathFunctions.h"
+#include "simd.h"
 #include "vector.h"
\ No newline at end of file
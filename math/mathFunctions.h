@@ -13,7 +13,7 @@ namespace math {
  * @return The multiplied Vector2 vector
  */
 template <typename T, typename S>
-inline Vector2<T> operator*(S s, const Vector2<T>& v) {
+constexpr Vector2<T> operator*(S s, const Vector2<T>& v) {
   return v * s;
 }
 
@@ -23,7 +23,7 @@ inline Vector2<T> operator*(S s, const Vector2<T>& v) {
  * @return The multiplied Vector3 vector
  */
 template <typename T, typename S>
-inline Vector3<T> operator*(S s, const Vector3<T>& v) {
+constexpr Vector3<T> operator*(S s, const Vector3<T>& v) {
   return v * s;
 }
 
@@ -33,7 +33,7 @@ inline Vector3<T> operator*(S s, const Vector3<T>& v) {
  * @return The multiplied Vector4 vector
  */
 template <typename T, typename S>
-inline Vector4<T> operator*(S s, const Vector4<T>& v) {
+constexpr Vector4<T> operator*(S s, const Vector4<T>& v) {
   return v * s;
 }
 
@@ -43,7 +43,7 @@ inline Vector4<T> operator*(S s, const Vector4<T>& v) {
  * @return Component-wise multiplied Vector2 vector
  */
 template <typename T>
-inline Vector2<T> operator*(const Vector2<T>& v0, const Vector2<T>& v1) {
+constexpr Vector2<T> operator*(const Vector2<T>& v0, const Vector2<T>& v1) {
   return Vector2<T>(v0.x * v1.x, v0.y * v1.y);
 }
 
@@ -53,7 +53,7 @@ inline Vector2<T> operator*(const Vector2<T>& v0, const Vector2<T>& v1) {
  * @return Component-wise multiplied Vector3 vector
  */
 template <typename T>
-inline Vector3<T> operator*(const Vector3<T>& v0, const Vector3<T>& v1) {
+constexpr Vector3<T> operator*(const Vector3<T>& v0, const Vector3<T>& v1) {
   return Vector3<T>(v0.x * v1.x, v0.y * v1.y, v0.z * v1.z);
 }
 
@@ -63,7 +63,7 @@ inline Vector3<T> operator*(const Vector3<T>& v0, const Vector3<T>& v1) {
  * @return Component-wise multiplied Vector4 vector
  */
 template <typename T>
-inline Vector4<T> operator*(const Vector4<T>& v0, const Vector4<T>& v1) {
+constexpr Vector4<T> operator*(const Vector4<T>& v0, const Vector4<T>& v1) {
   return Vector4<T>(v0.x * v1.x, v0.y * v1.y, v0.z * v1.z, v0.w * v1.w);
 }
 
@@ -100,7 +100,7 @@ inline Vector4<T> abs(const Vector4<T>& v) {
  * @return Dot product value of the two vectors
  */
 template <typename T>
-inline T dot(const Vector2<T>& v1, const Vector2<T>& v2) {
+constexpr T dot(const Vector2<T>& v1, const Vector2<T>& v2) {
   return v1.x * v2.x + v1.y * v2.y;
 }
 
@@ -110,7 +110,7 @@ inline T dot(const Vector2<T>& v1, const Vector2<T>& v2) {
  * @return Dot product value of the two vectors
  */
 template <typename T>
-inline T dot(const Vector3<T>& v1, const Vector3<T>& v2) {
+constexpr T dot(const Vector3<T>& v1, const Vector3<T>& v2) {
   return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
 }
 
@@ -120,7 +120,7 @@ inline T dot(const Vector3<T>& v1, const Vector3<T>& v2) {
  * @return Dot product value of the two vectors
  */
 template <typename T>
-inline T dot(const Vector4<T>& v1, const Vector4<T>& v2) {
+constexpr T dot(const Vector4<T>& v1, const Vector4<T>& v2) {
   return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
 }
 
@@ -130,7 +130,7 @@ inline T dot(const Vector4<T>& v1, const Vector4<T>& v2) {
  * @return Cross product value (scalar)
  */
 template <typename T>
-inline T cross(const Vector2<T>& v1, const Vector2<T>& v2) {
+constexpr T cross(const Vector2<T>& v1, const Vector2<T>& v2) {
   return v1.x * v2.y - v1.y * v2.x;
 }
 
@@ -140,7 +140,7 @@ inline T cross(const Vector2<T>& v1, const Vector2<T>& v2) {
  * @return Cross product value (Vector3 vector)
  */
 template <typename T>
-inline Vector3<T> cross(const Vector3<T>& v1, const Vector3<T>& v2) {
+constexpr Vector3<T> cross(const Vector3<T>& v1, const Vector3<T>& v2) {
   double v1x = v1.x, v1y = v1.y, v1z = v1.z;
   double v2x = v2.x, v2y = v2.y, v2z = v2.z;
 
@@ -153,7 +153,7 @@ inline Vector3<T> cross(const Vector3<T>& v1, const Vector3<T>& v2) {
  * @return Squared length value of the vector
  */
 template <typename T>
-inline float lengthSquared(const Vector2<T>& v) {
+constexpr float lengthSquared(const Vector2<T>& v) {
   return v.x * v.x + v.y * v.y;
 }
 
@@ -162,7 +162,7 @@ inline float lengthSquared(const Vector2<T>& v) {
  * @return Squared length value of the vector
  */
 template <typename T>
-inline float lengthSquared(const Vector3<T>& v) {
+constexpr float lengthSquared(const Vector3<T>& v) {
   return v.x * v.x + v.y * v.y + v.z * v.z;
 }
 
@@ -171,7 +171,7 @@ inline float lengthSquared(const Vector3<T>& v) {
  * @return Squared length value of the vector
  */
 template <typename T>
-inline float lengthSquared(const Vector4<T>& v) {
+constexpr float lengthSquared(const Vector4<T>& v) {
   return v.x * v.x + v.y * v.y + v.z * v.z + v.w * v.w;
 }
 
@@ -242,7 +242,7 @@ inline Vector4<T> normalize(const Vector4<T>& v) {
  * m2 m5 m8
  */
 template <typename T>
-Matrix33<T> transpose(const Matrix33<T>& m) {
+constexpr Matrix33<T> transpose(const Matrix33<T>& m) {
   Matrix33<T> result;
   auto dst = result.m;
   auto src = m.m;
@@ -272,7 +272,7 @@ Matrix33<T> transpose(const Matrix33<T>& m) {
  * m3 m7 m11	m15
  */
 template <typename T>
-Matrix44<T> transpose(const Matrix44<T>& m) {
+constexpr Matrix44<T> transpose(const Matrix44<T>& m) {
   Matrix44<T> result;
   auto dst = result.m;
   auto src = m.m;
@@ -305,7 +305,8 @@ Matrix44<T> transpose(const Matrix44<T>& m) {
  * @return Product of two matrices
  */
 template <typename T>
-Matrix33<T> operator*(const Matrix33<T>& m1, const Matrix33<T>& m2) {
+constexpr Matrix33<T> operator*(const Matrix33<T>& m1,
+                                const Matrix33<T>& m2) {
   auto m1Col0 = m1.getColum(0);
   auto m1Col1 = m1.getColum(1);
   auto m1Col2 = m1.getColum(2);
@@ -335,7 +336,8 @@ Matrix33<T> operator*(const Matrix33<T>& m1, const Matrix33<T>& m2) {
  * @return Product of two matrices
  */
 template <typename T>
-Matrix44<T> operator*(const Matrix44<T>& m1, const Matrix44<T>& m2) {
+constexpr Matrix44<T> operator*(const Matrix44<T>& m1,
+                                const Matrix44<T>& m2) {
   auto m1Col0 = m1.getColum(0);
   auto m1Col1 = m1.getColum(1);
   auto m1Col2 = m1.getColum(2);
@@ -378,7 +380,7 @@ Matrix44<T> operator*(const Matrix44<T>& m1, const Matrix44<T>& m2) {
  * m3 m7 m11	m15
  */
 template <typename T>
-Matrix44<T> inverse(const Matrix44<T>& src) {
+constexpr Matrix44<T> inverse(const Matrix44<T>& src) {
   Matrix44<T> result(static_cast<T>(1));
 
   T D_22_33 = src.get(2, 2) * src.get(3, 3) - src.get(2, 3) * src.get(3, 2);
@@ -465,6 +467,141 @@ Matrix44<T> inverse(const Matrix44<T>& src) {
   return result * oneOverDeterminant;
 }
 
+#ifdef SIMD_SSE2
+/**
+ * @brief SSE version of the 4x4 matrix product for float
+ *
+ * Each result column is the columns of m1 scaled by one column of m2 and
+ * summed, four rows per instruction.
+ */
+inline Matrix44<float> multiplySSE(const Matrix44<float>& m1,
+                                   const Matrix44<float>& m2) {
+  __m128 col0 = _mm_load_ps(m1.m);
+  __m128 col1 = _mm_load_ps(m1.m + 4);
+  __m128 col2 = _mm_load_ps(m1.m + 8);
+  __m128 col3 = _mm_load_ps(m1.m + 12);
+
+  Matrix44<float> result;
+  for (int i = 0; i < 4; ++i) {
+    const float* c = m2.m + i * 4;
+    __m128 r = _mm_mul_ps(col0, _mm_set1_ps(c[0]));
+    r = _mm_add_ps(r, _mm_mul_ps(col1, _mm_set1_ps(c[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(col2, _mm_set1_ps(c[2])));
+    r = _mm_add_ps(r, _mm_mul_ps(col3, _mm_set1_ps(c[3])));
+    _mm_store_ps(result.m + i * 4, r);
+  }
+
+  return result;
+}
+
+// Lane shuffles of the SSE inverse, lanes listed low to high
+#define MATH_SHUFFLE(a, b, x, y, z, w) \
+  _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define MATH_SWIZZLE(v, x, y, z, w) MATH_SHUFFLE(v, v, x, y, z, w)
+
+// 2x2 matrices held row by row in one register: a * b, adj(a) * b and
+// a * adj(b)
+inline __m128 mat2Mul(__m128 a, __m128 b) {
+  return _mm_add_ps(_mm_mul_ps(a, MATH_SWIZZLE(b, 0, 3, 0, 3)),
+                    _mm_mul_ps(MATH_SWIZZLE(a, 1, 0, 3, 2),
+                               MATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+inline __m128 mat2AdjMul(__m128 a, __m128 b) {
+  return _mm_sub_ps(_mm_mul_ps(MATH_SWIZZLE(a, 3, 3, 0, 0), b),
+                    _mm_mul_ps(MATH_SWIZZLE(a, 1, 1, 2, 2),
+                               MATH_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+inline __m128 mat2MulAdj(__m128 a, __m128 b) {
+  return _mm_sub_ps(_mm_mul_ps(a, MATH_SWIZZLE(b, 3, 0, 3, 0)),
+                    _mm_mul_ps(MATH_SWIZZLE(a, 1, 0, 3, 2),
+                               MATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+/**
+ * @brief SSE version of the 4x4 inverse for float
+ *
+ * Blockwise inversion over the four 2x2 sub-matrices A B / C D, their
+ * determinants and adjugates come out of a handful of shuffles. The inverse
+ * of the transpose is the transpose of the inverse, so the row-major
+ * formulation works unchanged on column-major storage.
+ */
+inline Matrix44<float> inverseSSE(const Matrix44<float>& src) {
+  __m128 col0 = _mm_load_ps(src.m);
+  __m128 col1 = _mm_load_ps(src.m + 4);
+  __m128 col2 = _mm_load_ps(src.m + 8);
+  __m128 col3 = _mm_load_ps(src.m + 12);
+
+  __m128 a = _mm_movelh_ps(col0, col1);
+  __m128 b = _mm_movehl_ps(col1, col0);
+  __m128 c = _mm_movelh_ps(col2, col3);
+  __m128 d = _mm_movehl_ps(col3, col2);
+
+  // |A| |B| |C| |D|
+  __m128 detSub = _mm_sub_ps(
+      _mm_mul_ps(MATH_SHUFFLE(col0, col2, 0, 2, 0, 2),
+                 MATH_SHUFFLE(col1, col3, 1, 3, 1, 3)),
+      _mm_mul_ps(MATH_SHUFFLE(col0, col2, 1, 3, 1, 3),
+                 MATH_SHUFFLE(col1, col3, 0, 2, 0, 2)));
+  __m128 detA = MATH_SWIZZLE(detSub, 0, 0, 0, 0);
+  __m128 detB = MATH_SWIZZLE(detSub, 1, 1, 1, 1);
+  __m128 detC = MATH_SWIZZLE(detSub, 2, 2, 2, 2);
+  __m128 detD = MATH_SWIZZLE(detSub, 3, 3, 3, 3);
+
+  __m128 dc = mat2AdjMul(d, c);
+  __m128 ab = mat2AdjMul(a, b);
+  __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mat2Mul(b, dc));
+  __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mat2Mul(c, ab));
+  __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mat2MulAdj(d, ab));
+  __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mat2MulAdj(a, dc));
+
+  // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+  __m128 trace = _mm_mul_ps(ab, MATH_SWIZZLE(dc, 0, 2, 1, 3));
+  trace = _mm_add_ps(trace, MATH_SWIZZLE(trace, 2, 3, 0, 1));
+  trace = _mm_add_ps(trace, MATH_SWIZZLE(trace, 1, 0, 3, 2));
+  __m128 detM = _mm_sub_ps(
+      _mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+
+  assert(_mm_cvtss_f32(detM) != 0);
+
+  // Adjugate signs folded into the reciprocal
+  __m128 oneOverDet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+  x = _mm_mul_ps(x, oneOverDet);
+  y = _mm_mul_ps(y, oneOverDet);
+  z = _mm_mul_ps(z, oneOverDet);
+  w = _mm_mul_ps(w, oneOverDet);
+
+  Matrix44<float> result;
+  _mm_store_ps(result.m, MATH_SHUFFLE(x, y, 3, 1, 3, 1));
+  _mm_store_ps(result.m + 4, MATH_SHUFFLE(x, y, 2, 0, 2, 0));
+  _mm_store_ps(result.m + 8, MATH_SHUFFLE(z, w, 3, 1, 3, 1));
+  _mm_store_ps(result.m + 12, MATH_SHUFFLE(z, w, 2, 0, 2, 0));
+
+  return result;
+}
+
+#undef MATH_SWIZZLE
+#undef MATH_SHUFFLE
+
+// The float overloads take the SSE versions at run time and the generic
+// ones in constant expressions
+constexpr Matrix44<float> operator*(const Matrix44<float>& m1,
+                                    const Matrix44<float>& m2) {
+  if (!MATH_IS_CONSTANT_EVALUATED()) {
+    return multiplySSE(m1, m2);
+  }
+  return operator*<float>(m1, m2);
+}
+
+constexpr Matrix44<float> inverse(const Matrix44<float>& src) {
+  if (!MATH_IS_CONSTANT_EVALUATED()) {
+    return inverseSSE(src);
+  }
+  return inverse<float>(src);
+}
+#endif
+
 /**
  * @brief Computes the inverse of a 3x3 matrix
  * @tparam T The data type of the matrix elements
@@ -487,7 +624,7 @@ Matrix44<T> inverse(const Matrix44<T>& src) {
  * possible.
  */
 template <typename T>
-Matrix33<T> inverse(const Matrix33<T>& src) {
+constexpr Matrix33<T> inverse(const Matrix33<T>& src) {
   Matrix33<T> result(static_cast<T>(1));
 
   // Calculate sub-determinants for cofactors
@@ -556,7 +693,7 @@ Matrix33<T> inverse(const Matrix33<T>& src) {
  * @return New matrix with scaling transformation applied
  */
 template <typename T, typename V>
-Matrix44<T> scale(const Matrix44<T>& src, V x, V y, V z) {
+constexpr Matrix44<T> scale(const Matrix44<T>& src, V x, V y, V z) {
   Matrix44<T> result;
 
   auto col0 = src.getColum(0);
@@ -587,7 +724,7 @@ Matrix44<T> scale(const Matrix44<T>& src, V x, V y, V z) {
  * @return New matrix with translation transformation applied
  */
 template <typename T, typename V>
-Matrix44<T> translate(const Matrix44<T>& src, V x, V y, V z) {
+constexpr Matrix44<T> translate(const Matrix44<T>& src, V x, V y, V z) {
   Matrix44<T> result(src);
   auto col0 = src.getColum(0);
   auto col1 = src.getColum(1);
@@ -609,7 +746,7 @@ Matrix44<T> translate(const Matrix44<T>& src, V x, V y, V z) {
  * @return New matrix with translation transformation applied
  */
 template <typename T, typename V>
-Matrix44<T> translate(const Matrix44<T>& src, const Vector3<V>& v) {
+constexpr Matrix44<T> translate(const Matrix44<T>& src, const Vector3<V>& v) {
   return translate(src, v.x, v.y, v.z);
 }
 
@@ -679,7 +816,8 @@ Matrix44<T> rotate(const Matrix44<T>& src, float angle, const Vector3<T>& v) {
  * @return Orthographic projection matrix
  */
 template <typename T>
-Matrix44<T> orthographic(T left, T right, T bottom, T top, T near, T far) {
+constexpr Matrix44<T> orthographic(T left, T right, T bottom, T top, T near,
+                                   T far) {
   Matrix44<T> result(static_cast<T>(1));
 
   result.set(0, 0, static_cast<T>(2) / (right - left));
@@ -687,7 +825,7 @@ Matrix44<T> orthographic(T left, T right, T bottom, T top, T near, T far) {
   result.set(1, 1, static_cast<T>(2) / (top - bottom));
   result.set(1, 3, -(top + bottom) / (top - bottom));
   result.set(2, 2, -static_cast<T>(2) / (far - near));
-  result.set(1, 3, -(far + near) / (far - near));
+  result.set(2, 3, -(far + near) / (far - near));
 
   return result;
 }
@@ -703,7 +841,9 @@ Matrix44<T> orthographic(T left, T right, T bottom, T top, T near, T far) {
  */
 template <typename T>
 Matrix44<T> perspective(T fovy, T aspect, T n, T f) {
-  T const tanHalfFovy = std::tan(DEG2RAD(fovy / static_cast<T>(2)));
+  // Degrees to radians by hand, DEG2RAD is defined after this header
+  T const tanHalfFovy =
+      std::tan(fovy / static_cast<T>(2) * static_cast<T>(0.01745329251994329));
 
   Matrix44<T> result(static_cast<T>(0));
   result.set(0, 0, static_cast<T>(1) / (aspect * tanHalfFovy));
@@ -723,7 +863,8 @@ Matrix44<T> perspective(T fovy, T aspect, T n, T f) {
  * @return Screen space transformation matrix
  */
 template <typename T>
-Matrix44<T> screenMatrix(const uint32_t& width, const uint32_t& height) {
+constexpr Matrix44<T> screenMatrix(const uint32_t& width,
+                                   const uint32_t& height) {
   Matrix44<T> result(static_cast<T>(1));
 
   // x
@@ -740,4 +881,77 @@ Matrix44<T> screenMatrix(const uint32_t& width, const uint32_t& height) {
 
   return result;
 }
+/**
+ * @brief Transforms count points stored as separate x/y/z/w arrays
+ * @param m Transform matrix
+ * @param x, y, z, w Input components, w may be null for points (w = 1)
+ * @param outX, outY, outZ, outW Output components, may alias the inputs
+ * @param count Number of points
+ *
+ * Each output array is one row of the matrix dotted with the inputs, so a
+ * register holds the same component of 8 points (one AVX or two SSE
+ * registers) and no shuffling is needed. Made for a vertex stage that keeps
+ * its positions in structure-of-arrays form.
+ */
+inline void transformBatch(const Matrix44<float>& m, const float* x,
+                           const float* y, const float* z, const float* w,
+                           float* outX, float* outY, float* outZ, float* outW,
+                           size_t count) {
+  const float* mm = m.m;
+  float* out[4] = {outX, outY, outZ, outW};
+  size_t i = 0;
+
+#if defined(SIMD_AVX)
+  for (; i + 8 <= count; i += 8) {
+    __m256 vx = _mm256_loadu_ps(x + i);
+    __m256 vy = _mm256_loadu_ps(y + i);
+    __m256 vz = _mm256_loadu_ps(z + i);
+    __m256 vw = w ? _mm256_loadu_ps(w + i) : _mm256_set1_ps(1.0f);
+    __m256 r[4];
+    for (int row = 0; row < 4; ++row) {
+      r[row] = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(vx, _mm256_set1_ps(mm[row])),
+                        _mm256_mul_ps(vy, _mm256_set1_ps(mm[row + 4]))),
+          _mm256_add_ps(_mm256_mul_ps(vz, _mm256_set1_ps(mm[row + 8])),
+                        _mm256_mul_ps(vw, _mm256_set1_ps(mm[row + 12]))));
+    }
+    // Stored after all rows are computed, outputs may alias inputs
+    for (int row = 0; row < 4; ++row) {
+      _mm256_storeu_ps(out[row] + i, r[row]);
+    }
+  }
+#elif defined(SIMD_SSE2)
+  for (; i + 8 <= count; i += 8) {
+    for (size_t half = i; half < i + 8; half += 4) {
+      __m128 vx = _mm_loadu_ps(x + half);
+      __m128 vy = _mm_loadu_ps(y + half);
+      __m128 vz = _mm_loadu_ps(z + half);
+      __m128 vw = w ? _mm_loadu_ps(w + half) : _mm_set1_ps(1.0f);
+      __m128 r[4];
+      for (int row = 0; row < 4; ++row) {
+        r[row] = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(mm[row])),
+                       _mm_mul_ps(vy, _mm_set1_ps(mm[row + 4]))),
+            _mm_add_ps(_mm_mul_ps(vz, _mm_set1_ps(mm[row + 8])),
+                       _mm_mul_ps(vw, _mm_set1_ps(mm[row + 12]))));
+      }
+      for (int row = 0; row < 4; ++row) {
+        _mm_storeu_ps(out[row] + half, r[row]);
+      }
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    float vx = x[i], vy = y[i], vz = z[i], vw = w ? w[i] : 1.0f;
+    float r[4];
+    for (int row = 0; row < 4; ++row) {
+      r[row] = (vx * mm[row] + vy * mm[row + 4]) +
+               (vz * mm[row + 8] + vw * mm[row + 12]);
+    }
+    for (int row = 0; row < 4; ++row) {
+      out[row][i] = r[row];
+    }
+  }
+}
 }  // namespace math
\ No newline at end of file
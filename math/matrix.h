@@ -1,15 +1,31 @@
 #pragma once
 #include <assert.h>
 
-#include <cstring>
 #include <iostream>
+#include <type_traits>
 
+#include "simd.h"
 #include "vector.h"
 
 namespace math {
 template <typename T>
 class Matrix44;
 
+#ifdef SIMD_SSE2
+// Columns of the column-major m scaled by the vector's components and
+// summed, one column per register. m must be 16-byte aligned
+inline Vector4<float> transformSSE(const float* m, const Vector4<float>& v) {
+  __m128 r = _mm_mul_ps(_mm_load_ps(m), _mm_set1_ps(v.x));
+  r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(m + 4), _mm_set1_ps(v.y)));
+  r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(m + 8), _mm_set1_ps(v.z)));
+  r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(m + 12), _mm_set1_ps(v.w)));
+
+  alignas(16) float result[4];
+  _mm_store_ps(result, r);
+  return Vector4<float>(result[0], result[1], result[2], result[3]);
+}
+#endif
+
 /*
  * m0 m3 m6
  * m1 m4 m7
@@ -18,14 +34,13 @@ class Matrix44;
 template <typename T>
 class Matrix33 {
  public:
-  Matrix33() {}
-  Matrix33(T v) { m[0] = m[4] = m[8] = v; }
+  constexpr Matrix33() {}
+  constexpr Matrix33(T v) { m[0] = m[4] = m[8] = v; }
 
-  Matrix33(const Matrix33<T>& src) {
-    memcpy((void*)m, (void*)src.m, sizeof(T) * 9);
-  }
+  constexpr Matrix33(const Matrix33<T>& src) = default;
+  constexpr Matrix33<T>& operator=(const Matrix33<T>& src) = default;
 
-  Matrix33(const Matrix44<T>& src) {
+  constexpr Matrix33(const Matrix44<T>& src) {
     m[0] = src.m[0];
     m[3] = src.m[4];
     m[6] = src.m[8];
@@ -37,7 +52,7 @@ class Matrix33 {
     m[8] = src.m[10];
   }
 
-  Matrix33<T> operator*(const T& s) {
+  constexpr Matrix33<T> operator*(const T& s) const {
     Matrix33<T> result;
 
     auto col0 = this->getColum(0) * s;
@@ -51,18 +66,19 @@ class Matrix33 {
     return result;
   }
 
-  Vector3<T> operator*(const Vector3<T>& v) {
-    return Vector3(v.x * m[0] + v.y * m[3] + v.z * m[6],
-                   v.x * m[1] + v.y * m[4] + v.z * m[7],
-                   v.x * m[2] + v.y * m[5] + v.z * m[8]);
+  constexpr Vector3<T> operator*(const Vector3<T>& v) const {
+    return Vector3<T>(v.x * m[0] + v.y * m[3] + v.z * m[6],
+                      v.x * m[1] + v.y * m[4] + v.z * m[7],
+                      v.x * m[2] + v.y * m[5] + v.z * m[8]);
   }
 
-  void set(const uint32_t& row, const uint32_t& col, T t) {
+  constexpr void set(const uint32_t& row, const uint32_t& col, T t) {
     assert(row < 3 && col < 3);
     m[col * 3 + row] = t;
   }
 
-  void set(T m00, T m01, T m02, T m10, T m11, T m12, T m20, T m21, T m22) {
+  constexpr void set(T m00, T m01, T m02, T m10, T m11, T m12, T m20, T m21,
+                     T m22) {
     m[0] = m00;
     m[3] = m01;
     m[6] = m02;
@@ -74,18 +90,18 @@ class Matrix33 {
     m[8] = m22;
   }
 
-  Matrix33<T> identity() {
+  constexpr Matrix33<T> identity() {
     set(1, 0, 0, 0, 1, 0, 0, 0, 1);
 
     return *this;
   }
 
-  Vector3<T> getColum(const uint32_t& col) const {
+  constexpr Vector3<T> getColum(const uint32_t& col) const {
     assert(col < 3);
     return Vector3<T>(m[col * 3], m[col * 3 + 1], m[col * 3 + 2]);
   }
 
-  void setColum(const Vector3<T>& cvalue, const uint32_t& col) {
+  constexpr void setColum(const Vector3<T>& cvalue, const uint32_t& col) {
     assert(col < 3);
     m[col * 3] = cvalue.x;
     m[col * 3 + 1] = cvalue.y;
@@ -113,14 +129,13 @@ class Matrix33 {
 template <typename T>
 class Matrix44 {
  public:
-  Matrix44() {}
-  Matrix44(T v) { m[0] = m[5] = m[10] = m[15] = v; }
+  constexpr Matrix44() {}
+  constexpr Matrix44(T v) { m[0] = m[5] = m[10] = m[15] = v; }
 
-  Matrix44(const Matrix44<T>& src) {
-    memcpy((void*)m, (void*)src.m, sizeof(T) * 16);
-  }
+  constexpr Matrix44(const Matrix44<T>& src) = default;
+  constexpr Matrix44<T>& operator=(const Matrix44<T>& src) = default;
 
-  Matrix44<T> operator*(const T& s) {
+  constexpr Matrix44<T> operator*(const T& s) const {
     Matrix44<T> result;
 
     auto col0 = this->getColum(0) * s;
@@ -136,25 +151,32 @@ class Matrix44 {
     return result;
   }
 
-  Vector4<T> operator*(const Vector4<T>& v) {
-    return Vector4(v.x * m[0] + v.y * m[4] + v.z * m[8] + v.w * m[12],
-                   v.x * m[1] + v.y * m[5] + v.z * m[9] + v.w * m[13],
-                   v.x * m[2] + v.y * m[6] + v.z * m[10] + v.w * m[14],
-                   v.x * m[3] + v.y * m[7] + v.z * m[11] + v.w * m[15]);
+  constexpr Vector4<T> operator*(const Vector4<T>& v) const {
+#ifdef SIMD_SSE2
+    if constexpr (std::is_same<T, float>::value) {
+      if (!MATH_IS_CONSTANT_EVALUATED()) {
+        return transformSSE(m, v);
+      }
+    }
+#endif
+    return Vector4<T>(v.x * m[0] + v.y * m[4] + v.z * m[8] + v.w * m[12],
+                      v.x * m[1] + v.y * m[5] + v.z * m[9] + v.w * m[13],
+                      v.x * m[2] + v.y * m[6] + v.z * m[10] + v.w * m[14],
+                      v.x * m[3] + v.y * m[7] + v.z * m[11] + v.w * m[15]);
   }
 
-  T get(const uint32_t& row, const uint32_t& col) const {
+  constexpr T get(const uint32_t& row, const uint32_t& col) const {
     assert(row < 4 && col < 4);
     return m[col * 4 + row];
   }
 
-  void set(const uint32_t& row, const uint32_t& col, T t) {
+  constexpr void set(const uint32_t& row, const uint32_t& col, T t) {
     assert(row < 4 && col < 4);
     m[col * 4 + row] = t;
   }
 
-  void set(T m00, T m01, T m02, T m03, T m10, T m11, T m12, T m13, T m20, T m21,
-           T m22, T m23, T m30, T m31, T m32, T m33) {
+  constexpr void set(T m00, T m01, T m02, T m03, T m10, T m11, T m12, T m13,
+                     T m20, T m21, T m22, T m23, T m30, T m31, T m32, T m33) {
     m[0] = m00;
     m[4] = m01;
     m[8] = m02;
@@ -173,19 +195,19 @@ class Matrix44 {
     m[15] = m33;
   }
 
-  Matrix44<T> identity() {
+  constexpr Matrix44<T> identity() {
     set(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
 
     return *this;
   }
 
-  Vector4<T> getColum(const uint32_t& col) const {
+  constexpr Vector4<T> getColum(const uint32_t& col) const {
     assert(col < 4);
     return Vector4<T>(m[col * 4], m[col * 4 + 1], m[col * 4 + 2],
                       m[col * 4 + 3]);
   }
 
-  void setColum(const Vector4<T>& cvalue, const uint32_t& col) {
+  constexpr void setColum(const Vector4<T>& cvalue, const uint32_t& col) {
     assert(col < 4);
     m[col * 4] = cvalue.x;
     m[col * 4 + 1] = cvalue.y;
@@ -207,7 +229,8 @@ class Matrix44 {
   }
 
  public:
-  T m[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+  // Aligned so that each column is one SSE load
+  alignas(16) T m[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
 };
 
 using Mat3f = Matrix33<float>;
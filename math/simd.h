@@ -0,0 +1,43 @@
+#pragma once
+
+// SSE2 is baseline on x86-64, MSVC does not define __SSE2__ there
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX only when the compiler targets it (-mavx, /arch:AVX)
+#if defined(SIMD_SSE2) && defined(__AVX__)
+#define SIMD_AVX 1
+#include <immintrin.h>
+#endif
+
+// Byte shuffles likewise only when targeted (-mssse3, -mavx2, /arch:AVX2).
+// MSVC has no SSSE3 macro, AVX2 implies it
+#if defined(SIMD_SSE2) && (defined(__SSSE3__) || defined(__AVX2__))
+#define SIMD_SSSE3 1
+#include <tmmintrin.h>
+#endif
+#if defined(SIMD_AVX) && defined(__AVX2__)
+#define SIMD_AVX2 1
+#endif
+
+// True while a constexpr function runs at compile time, where intrinsics
+// are not allowed, so SIMD paths can fall back to scalar code there.
+// std::is_constant_evaluated is C++20, the builtin behind it is available
+// earlier. Without it SIMD paths are always taken and only the scalar types
+// work in constant expressions
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define MATH_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#if !defined(MATH_IS_CONSTANT_EVALUATED)
+#if (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9) || \
+    (defined(_MSC_VER) && _MSC_VER >= 1925)
+#define MATH_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define MATH_IS_CONSTANT_EVALUATED() false
+#endif
+#endif
@@ -15,34 +15,34 @@ template <typename T>
 class Vector2 {
  public:
   /** Default constructor, initializes x and y components to 0 */
-  Vector2() { x = y = 0; }
+  constexpr Vector2() : x(0), y(0) {}
 
   /** Constructor with given x and y values
    * @param x The x component value
    * @param y The y component value
    */
-  Vector2(T x, T y) : x(x), y(y) {}
+  constexpr Vector2(T x, T y) : x(x), y(y) {}
 
   /** Copy constructor
    * @param v Vector2 object to copy from
    */
-  Vector2(const Vector2<T>& v) : x(v.x), y(v.y) {}
+  constexpr Vector2(const Vector2<T>& v) = default;
 
   /** Constructor from Vector3, taking x and y components
    * @param v Vector3 object to convert from
    */
-  Vector2(const Vector3<T>& v) : x(v.x), y(v.y) {}
+  constexpr Vector2(const Vector3<T>& v) : x(v.x), y(v.y) {}
 
   /** Constructor from Vector4, taking x and y components
    * @param v Vector4 object to convert from
    */
-  Vector2(const Vector4<T>& v) : x(v.x), y(v.y) {}
+  constexpr Vector2(const Vector4<T>& v) : x(v.x), y(v.y) {}
 
   /** Get component value at specified index
    * @param i Component index (0 for x, 1 for y)
    * @return The component value at the specified index
    */
-  T operator[](int i) const {
+  constexpr T operator[](int i) const {
     assert(i >= 0 && i < 2);
 
     if (i == 0) return x;
@@ -54,7 +54,7 @@ class Vector2 {
    * @param i Component index (0 for x, 1 for y)
    * @return Reference to the component at the specified index
    */
-  T& operator[](int i) {
+  constexpr T& operator[](int i) {
     assert(i >= 0 && i < 2);
 
     if (i == 0) return x;
@@ -66,7 +66,7 @@ class Vector2 {
    * @param v Vector3 object to assign from
    * @return The assigned Vector2 object
    */
-  Vector2<T> operator=(const Vector3<T>& v) {
+  constexpr Vector2<T> operator=(const Vector3<T>& v) {
     x = v.x;
     y = v.y;
     return *this;
@@ -76,7 +76,7 @@ class Vector2 {
    * @param v Vector4 object to assign from
    * @return The assigned Vector2 object
    */
-  Vector2<T> operator=(const Vector4<T>& v) {
+  constexpr Vector2<T> operator=(const Vector4<T>& v) {
     x = v.x;
     y = v.y;
     return *this;
@@ -86,7 +86,7 @@ class Vector2 {
    * @param v Vector to add
    * @return The resulting vector after addition
    */
-  Vector2<T> operator+(const Vector2<T>& v) const {
+  constexpr Vector2<T> operator+(const Vector2<T>& v) const {
     return Vector2(x + v.x, y + v.y);
   }
 
@@ -94,23 +94,41 @@ class Vector2 {
    * @param v Vector to self-add
    * @return The self-added vector
    */
-  Vector2<T> operator+=(const Vector2<T>& v) {
+  constexpr Vector2<T> operator+=(const Vector2<T>& v) {
     x += v.x;
     y += v.y;
     return *this;
   }
 
+  /** Vector subtraction operator overload
+   * @param v Vector to subtract
+   * @return The resulting vector after subtraction
+   */
+  constexpr Vector2<T> operator-(const Vector2<T>& v) const {
+    return Vector2(x - v.x, y - v.y);
+  }
+
+  /** Vector self-subtraction operator overload
+   * @param v Vector to self-subtract
+   * @return The self-subtracted vector
+   */
+  constexpr Vector2<T> operator-=(const Vector2<T>& v) {
+    x -= v.x;
+    y -= v.y;
+    return *this;
+  }
+
   /** Vector-scalar multiplication operator overload
    * @param s Scalar value to multiply
    * @return The resulting vector after multiplication
    */
-  Vector2<T> operator*(T s) const { return Vector2(x * s, y * s); }
+  constexpr Vector2<T> operator*(T s) const { return Vector2(x * s, y * s); }
 
   /** Vector-scalar self-multiplication operator overload
    * @param s Scalar value to self-multiply
    * @return The self-multiplied vector
    */
-  Vector2<T> operator*=(T s) {
+  constexpr Vector2<T> operator*=(T s) {
     x *= s;
     y *= s;
     return *this;
@@ -120,7 +138,7 @@ class Vector2 {
    * @param f Scalar value to divide by
    * @return The resulting vector after division
    */
-  Vector2<T> operator/(T f) const {
+  constexpr Vector2<T> operator/(T f) const {
     assert(f != 0);
     float inv = static_cast<T>(1) / f;
     return Vector2(x * inv, y * inv);
@@ -130,7 +148,7 @@ class Vector2 {
    * @param f Scalar value to divide by
    * @return The resulting vector after division
    */
-  Vector2<T> operator/=(T f) {
+  constexpr Vector2<T> operator/=(T f) {
     assert(f != 0);
     float inv = static_cast<T>(1) / f;
     x *= inv;
@@ -141,7 +159,7 @@ class Vector2 {
   /** Unary negation operator overload
    * @return The negated vector
    */
-  Vector2<T> operator-() { return Vector2(-x, -y); }
+  constexpr Vector2<T> operator-() const { return Vector2(-x, -y); }
 
   /** Print the vector values to console */
   void print() {
@@ -159,30 +177,30 @@ template <typename T>
 class Vector3 {
  public:
   /** Default constructor, initializes x, y and z components to 0 */
-  Vector3() { x = y = z = 0; }
+  constexpr Vector3() : x(0), y(0), z(0) {}
 
   /** Constructor with given x, y and z values
    * @param x The x component value
    * @param y The y component value
    * @param z The z component value
    */
-  Vector3(T x, T y, T z) : x(x), y(y), z(z) {}
+  constexpr Vector3(T x, T y, T z) : x(x), y(y), z(z) {}
 
   /** Copy constructor
    * @param v Vector3 object to copy from
    */
-  Vector3(const Vector3<T>& v) : x(v.x), y(v.y), z(v.z) {}
+  constexpr Vector3(const Vector3<T>& v) = default;
 
   /** Constructor from Vector4, taking x, y and z components
    * @param v Vector4 object to convert from
    */
-  Vector3(const Vector4<T>& v) : x(v.x), y(v.y), z(v.z) {}
+  constexpr Vector3(const Vector4<T>& v) : x(v.x), y(v.y), z(v.z) {}
 
   /** Get component value at specified index
    * @param i Component index (0 for x, 1 for y, 2 for z)
    * @return The component value at the specified index
    */
-  T operator[](int i) const {
+  constexpr T operator[](int i) const {
     assert(i >= 0 && i <= 2);
 
     if (i == 0) return x;
@@ -195,7 +213,7 @@ class Vector3 {
    * @param i Component index (0 for x, 1 for y, 2 for z)
    * @return Reference to the component at the specified index
    */
-  T& operator[](int i) {
+  constexpr T& operator[](int i) {
     assert(i >= 0 && i <= 2);
 
     if (i == 0) return x;
@@ -208,7 +226,7 @@ class Vector3 {
    * @param v Vector2 object to assign from
    * @return The assigned Vector3 object
    */
-  Vector3<T> operator=(const Vector2<T>& v) {
+  constexpr Vector3<T> operator=(const Vector2<T>& v) {
     x = v.x;
     y = v.y;
     return *this;
@@ -218,7 +236,7 @@ class Vector3 {
    * @param v Vector4 object to assign from
    * @return The assigned Vector3 object
    */
-  Vector3<T> operator=(const Vector4<T>& v) {
+  constexpr Vector3<T> operator=(const Vector4<T>& v) {
     x = v.x;
     y = v.y;
     z = v.z;
@@ -229,7 +247,7 @@ class Vector3 {
    * @param v Vector to add
    * @return The resulting vector after addition
    */
-  Vector3<T> operator+(const Vector3<T>& v) const {
+  constexpr Vector3<T> operator+(const Vector3<T>& v) const {
     return Vector3<T>(x + v.x, y + v.y, z + v.z);
   }
 
@@ -237,7 +255,7 @@ class Vector3 {
    * @param v Vector to self-add
    * @return The self-added vector
    */
-  Vector3<T> operator+=(const Vector3<T>& v) {
+  constexpr Vector3<T> operator+=(const Vector3<T>& v) {
     x += v.x;
     y += v.y;
     z += v.z;
@@ -248,7 +266,7 @@ class Vector3 {
    * @param v Vector to subtract
    * @return The resulting vector after subtraction
    */
-  Vector3<T> operator-(const Vector3<T>& v) const {
+  constexpr Vector3<T> operator-(const Vector3<T>& v) const {
     return Vector3(x - v.x, y - v.y, z - v.z);
   }
 
@@ -256,7 +274,7 @@ class Vector3 {
    * @param v Vector to self-subtract
    * @return The self-subtracted vector
    */
-  Vector3<T> operator-=(const Vector3<T>& v) {
+  constexpr Vector3<T> operator-=(const Vector3<T>& v) {
     x -= v.x;
     y -= v.y;
     z -= v.z;
@@ -267,13 +285,15 @@ class Vector3 {
    * @param s Scalar value to multiply
    * @return The resulting vector after multiplication
    */
-  Vector3<T> operator*(T s) const { return Vector3(x * s, y * s, z * s); }
+  constexpr Vector3<T> operator*(T s) const {
+    return Vector3(x * s, y * s, z * s);
+  }
 
   /** Vector-scalar self-multiplication operator overload
    * @param s Scalar value to self-multiply
    * @return The self-multiplied vector
    */
-  Vector3<T> operator*=(T s) {
+  constexpr Vector3<T> operator*=(T s) {
     x *= s;
     y *= s;
     z *= s;
@@ -284,7 +304,7 @@ class Vector3 {
    * @param f Scalar value to divide by
    * @return The resulting vector after division
    */
-  Vector3<T> operator/(T f) const {
+  constexpr Vector3<T> operator/(T f) const {
     assert(f != 0);
     float inv = 1.0 / f;
     return Vector3(x * inv, y * inv, z * inv);
@@ -294,7 +314,7 @@ class Vector3 {
    * @param f Scalar value to divide by
    * @return The resulting vector after division
    */
-  Vector3<T> operator/=(T f) {
+  constexpr Vector3<T> operator/=(T f) {
     assert(f != 0);
     float inv = 1.0 / f;
     x *= inv;
@@ -306,7 +326,7 @@ class Vector3 {
   /** Unary negation operator overload
    * @return The negated vector
    */
-  Vector3<T> operator-() const { return Vector3<T>(-x, -y, -z); }
+  constexpr Vector3<T> operator-() const { return Vector3<T>(-x, -y, -z); }
 
   /** Print the vector values to console */
   void print() {
@@ -324,7 +344,7 @@ template <typename T>
 class Vector4 {
  public:
   /** Default constructor, initializes x, y, z and w components to 0 */
-  Vector4() { x = y = z = w = 0; }
+  constexpr Vector4() : x(0), y(0), z(0), w(0) {}
 
   /** Constructor with given x, y, z and w values
    * @param x The x component value
@@ -332,18 +352,18 @@ class Vector4 {
    * @param z The z component value
    * @param w The w component value
    */
-  Vector4(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+  constexpr Vector4(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
 
   /** Copy constructor
    * @param v Vector4 object to copy from
    */
-  Vector4(const Vector4<T>& v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+  constexpr Vector4(const Vector4<T>& v) = default;
 
   /** Get component value at specified index
    * @param i Component index (0 for x, 1 for y, 2 for z, 3 for w)
    * @return The component value at the specified index
    */
-  T operator[](int i) const {
+  constexpr T operator[](int i) const {
     assert(i >= 0 && i <= 3);
 
     if (i == 0) return x;
@@ -357,7 +377,7 @@ class Vector4 {
    * @param i Component index (0 for x, 1 for y, 2 for z, 3 for w)
    * @return Reference to the component at the specified index
    */
-  T& operator[](int i) {
+  constexpr T& operator[](int i) {
     assert(i >= 0 && i <= 3);
 
     if (i == 0) return x;
@@ -371,7 +391,7 @@ class Vector4 {
    * @param v Vector2 object to assign from
    * @return The assigned Vector4 object
    */
-  Vector4<T> operator=(const Vector2<T>& v) {
+  constexpr Vector4<T> operator=(const Vector2<T>& v) {
     x = v.x;
     y = v.y;
     ;
@@ -382,7 +402,7 @@ class Vector4 {
    * @param v Vector3 object to assign from
    * @return The assigned Vector4 object
    */
-  Vector4<T> operator=(const Vector3<T>& v) {
+  constexpr Vector4<T> operator=(const Vector3<T>& v) {
     x = v.x;
     y = v.y;
     z = v.z;
@@ -393,7 +413,7 @@ class Vector4 {
    * @param v Vector to add
    * @return The resulting vector after addition
    */
-  Vector4<T> operator+(const Vector4<T>& v) const {
+  constexpr Vector4<T> operator+(const Vector4<T>& v) const {
     return Vector4(x + v.x, y + v.y, z + v.z, w + v.w);
   }
 
@@ -401,7 +421,7 @@ class Vector4 {
    * @param v Vector to self-add
    * @return The self-added vector
    */
-  Vector4<T> operator+=(const Vector4<T>& v) {
+  constexpr Vector4<T> operator+=(const Vector4<T>& v) {
     x += v.x;
     y += v.y;
     z += v.z;
@@ -413,7 +433,7 @@ class Vector4 {
    * @param v Vector to subtract
    * @return The resulting vector after subtraction
    */
-  Vector4<T> operator-(const Vector4<T>& v) const {
+  constexpr Vector4<T> operator-(const Vector4<T>& v) const {
     return Vector4<T>(x - v.x, y - v.y, z - v.z, w - v.w);
   }
 
@@ -421,7 +441,7 @@ class Vector4 {
    * @param v Vector to self-subtract
    * @return The self-subtracted vector
    */
-  Vector4<T> operator-=(const Vector4<T>& v) {
+  constexpr Vector4<T> operator-=(const Vector4<T>& v) {
     x -= v.x;
     y -= v.y;
     z -= v.z;
@@ -433,7 +453,7 @@ class Vector4 {
    * @param s Scalar value to multiply
    * @return The resulting vector after multiplication
    */
-  Vector4<T> operator*(T s) const {
+  constexpr Vector4<T> operator*(T s) const {
     return Vector4(x * s, y * s, z * s, w * s);
   }
 
@@ -441,7 +461,7 @@ class Vector4 {
    * @param s Scalar value to self-multiply
    * @return The self-multiplied vector
    */
-  Vector4<T> operator*=(T s) {
+  constexpr Vector4<T> operator*=(T s) {
     x *= s;
     y *= s;
     z *= s;
@@ -454,7 +474,7 @@ class Vector4 {
    * @param v Vector3 object to multiply with
    * @return The resulting vector after multiplication
    */
-  Vector4<T> operator*=(const Vector3<T>& v) {
+  constexpr Vector4<T> operator*=(const Vector3<T>& v) {
     x *= v.x;
     y *= v.y;
     z *= v.z;
@@ -465,7 +485,7 @@ class Vector4 {
    * @param f Scalar value to divide by
    * @return The resulting vector after division
    */
-  Vector4<T> operator/(T f) const {
+  constexpr Vector4<T> operator/(T f) const {
     assert(f != 0);
     float inv = 1.0 / f;
     return Vector4(x * inv, y * inv, z * inv, w * inv);
@@ -475,7 +495,7 @@ class Vector4 {
    * @param f Scalar value to divide by
    * @return The resulting vector after division
    */
-  Vector4<T> operator/=(T f) {
+  constexpr Vector4<T> operator/=(T f) {
     assert(f != 0);
     float inv = 1.0 / f;
     x *= inv;
@@ -488,7 +508,7 @@ class Vector4 {
   /** Unary negation operator overload
    * @return The negated vector
    */
-  Vector4<T> operator-() const { return Vector3(-x, -y, -z, -w); }
+  constexpr Vector4<T> operator-() const { return Vector4(-x, -y, -z, -w); }
 
   /** Print the vector values to console */
   void print() {
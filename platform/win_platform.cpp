@@ -1,5 +1,7 @@
 #include "win_platform.h"
 
+#include <cstring>
+
 WinPlatformWindow::WinPlatformWindow() {
   mWindowInst = GetModuleHandle(nullptr);
 }